@@ -28,6 +28,7 @@ namespace ble {
     enum class char_uuid: uint16_t {
         meta_device_uid    = 0x01 + (uint16_t)service_uuid::meta,
         meta_sys_control   = 0x02 + (uint16_t)service_uuid::meta,
+        meta_pipeline      = 0x03 + (uint16_t)service_uuid::meta, // write channel, read led::pipeline_stats
         meta_stat_msg      = 0x40 + (uint16_t)service_uuid::meta,
 
         ucode_program      = 0x01 + (uint16_t)service_uuid::ucode,
@@ -40,23 +41,31 @@ namespace ble {
         led0_length        = 0x01 + (uint16_t)service_uuid::led0, // read/write led strip length
         led0_color_mode    = 0x02 + (uint16_t)service_uuid::led0, // hsv/hsl/rgb
         led0_refresh_rate  = 0x03 + (uint16_t)service_uuid::led0, // read/write refresh rate
+        led0_max_frame_rate = 0x04 + (uint16_t)service_uuid::led0, // read frames per second the strip allows
+        led0_color_correction = 0x05 + (uint16_t)service_uuid::led0, // read/write gamma, white balance, brightness
         led0_control       = 0x80 + (uint16_t)service_uuid::led0, // reset, simple programming functionality
 #if MAX_LED_CHANNELS >= 2
         led1_length        = 0x01 + (uint16_t)service_uuid::led1, // read/write led strip length
         led1_color_mode    = 0x02 + (uint16_t)service_uuid::led1, // hsv/hsl/rgb
         led1_refresh_rate  = 0x03 + (uint16_t)service_uuid::led1, // read/write refresh rate
+        led1_max_frame_rate = 0x04 + (uint16_t)service_uuid::led1, // read frames per second the strip allows
+        led1_color_correction = 0x05 + (uint16_t)service_uuid::led1, // read/write gamma, white balance, brightness
         led1_control       = 0x80 + (uint16_t)service_uuid::led1, // reset, simple programming functionality
 #endif
 #if MAX_LED_CHANNELS >= 3
         led2_length        = 0x01 + (uint16_t)service_uuid::led2, // read/write led strip length
         led2_color_mode    = 0x02 + (uint16_t)service_uuid::led2, // hsv/hsl/rgb
         led2_refresh_rate  = 0x03 + (uint16_t)service_uuid::led2, // read/write refresh rate
+        led2_max_frame_rate = 0x04 + (uint16_t)service_uuid::led2, // read frames per second the strip allows
+        led2_color_correction = 0x05 + (uint16_t)service_uuid::led2, // read/write gamma, white balance, brightness
         led2_control       = 0x80 + (uint16_t)service_uuid::led2, // reset, simple programming functionality
 #endif
 #if MAX_LED_CHANNELS >= 4
         led3_length        = 0x01 + (uint16_t)service_uuid::led3, // read/write led strip length
         led3_color_mode    = 0x02 + (uint16_t)service_uuid::led3, // hsv/hsl/rgb
         led3_refresh_rate  = 0x03 + (uint16_t)service_uuid::led3, // read/write refresh rate
+        led3_max_frame_rate = 0x04 + (uint16_t)service_uuid::led3, // read frames per second the strip allows
+        led3_color_correction = 0x05 + (uint16_t)service_uuid::led3, // read/write gamma, white balance, brightness
         led3_control       = 0x80 + (uint16_t)service_uuid::led3, // reset, simple programming functionality
 #endif
 
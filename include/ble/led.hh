@@ -12,9 +12,15 @@
         CHARACTERISTIC(num_leds_char);\
         CHARACTERISTIC(color_mode_char);\
         CHARACTERISTIC(refresh_rate_char);\
+        CHARACTERISTIC(max_frame_rate_char);\
+        CHARACTERISTIC(color_correction_char);\
         CHARACTERISTIC(control_char);\
         ret_code_t render(led::transcode *transcoder, led::renderer_props const &props) override;\
         ret_code_t init_render(led::renderer_props const &props) override;\
+        led::render_stats stats() override;\
+        bool is_idle() override;\
+        size_t arena_bytes_per_led(size_t channels) override;\
+        void set_arena(uint8_t *pixels, size_t n_leds, size_t channels) override;\
         uint16_t service_handle() override;\
         void reset();\
         \
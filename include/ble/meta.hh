@@ -2,6 +2,7 @@
 
 #include "prelude.hh"
 #include "ble/service.hh"
+#include "led/pipeline.hh"
 
 namespace meta {
     struct service: ble::service {
@@ -12,6 +13,9 @@ namespace meta {
         CHARACTERISTIC(device_uid_char);
         CHARACTERISTIC(system_control_char);
         CHARACTERISTIC(log_char);
+#if LED_PIPELINE_STATS
+        CHARACTERISTIC(pipeline_char);
+#endif
         // CHARACTERISTIC(taskmgr_char);
 
         uint16_t service_handle() override;
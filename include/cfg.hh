@@ -64,20 +64,29 @@ namespace cfg {
         constexpr auto config = param<dmx_config_t>(id::dmx_channel, 1);
     }
 
-    /* LED driver configuration parameters */
+    /* LED driver configuration parameters. `dmx_window` is the channel's
+     * DMX slots, or channel 0 for those of `dmx::config`. */
     namespace led0 {
         constexpr auto render = param<led_render_t>(id::led0_render, 1);
+        constexpr auto color = param<led_color_t>(id::led0_color, 2);
+        constexpr auto dmx_window = param<dmx_config_t>(id::led0_dmx, 1);
     }
 
     namespace led1 {
         constexpr auto render = param<led_render_t>(id::led1_render, 1);
+        constexpr auto color = param<led_color_t>(id::led1_color, 2);
+        constexpr auto dmx_window = param<dmx_config_t>(id::led1_dmx, 1);
     }
 
     namespace led2 {
         constexpr auto render = param<led_render_t>(id::led2_render, 1);
+        constexpr auto color = param<led_color_t>(id::led2_color, 2);
+        constexpr auto dmx_window = param<dmx_config_t>(id::led2_dmx, 1);
     }
 
     namespace led3 {
         constexpr auto render = param<led_render_t>(id::led3_render, 1);
+        constexpr auto color = param<led_color_t>(id::led3_color, 2);
+        constexpr auto dmx_window = param<dmx_config_t>(id::led3_dmx, 1);
     }
 }
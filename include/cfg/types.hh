@@ -36,4 +36,12 @@ namespace cfg {
         uint16_t refresh_msec;
         uint8_t color_mode;
     };
+
+    /* see `color::correction` */
+    packed_struct led_color_t {
+        uint8_t gamma;          /* in tenths, 10 is linear */
+        uint8_t gains[3];       /* red, green, blue white balance, 255 is 1.0 */
+        uint8_t brightness;     /* master dimmer, 255 is full brightness */
+        uint8_t white;          /* 1 moves the white in red, green and blue to the white channel, see `color::extract_white` */
+    };
 }
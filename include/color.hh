@@ -34,6 +34,33 @@ namespace color {
         uint8_t blue;
     };
 
+    /* the pixel of a strip with a white channel */
+    packed_struct rgbw {
+        constexpr rgbw(): red(0), green(0), blue(0), white(0) {}
+
+        constexpr rgbw(rgb const &color, uint8_t w):
+            red(color.red), green(color.green), blue(color.blue), white(w)
+        {}
+
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+        uint8_t white;
+    };
+
+    /**
+     * @brief Move the part of red, green and blue that they have in common
+     *        to the white channel, which saturates.
+     */
+    inline void extract_white(rgbw &value)
+    {
+        auto const common = std::min({ value.red, value.green, value.blue });
+        value.red -= common;
+        value.green -= common;
+        value.blue -= common;
+        value.white = (uint8_t)std::min<uint32_t>(value.white + common, UINT8_MAX);
+    }
+
     packed_struct hsv {
         hsv(uint8_t h, uint8_t s, uint8_t v);
 
@@ -57,4 +84,46 @@ namespace color {
 
         void to_rgb(rgb& result, curve curve);
     };
+
+    /**
+     * @brief Gamma, white balance and brightness, folded into one lookup
+     *        table per color. White has no white balance of its own.
+     */
+    struct correction {
+        constexpr correction():
+            table {}
+        {}
+
+        /**
+         * @brief Fill in the tables.
+         *
+         * @param gamma In tenths, 10 is linear.
+         * @param gains Red, green and blue gains, 255 leaves a color as is.
+         * @param brightness 255 is full brightness.
+         */
+        void build(uint8_t gamma, uint8_t const gains[3], uint8_t brightness);
+
+        /* whether the tables would leave every color as it is */
+        static inline bool is_identity(uint8_t gamma, uint8_t const gains[3], uint8_t brightness)
+        {
+            return gamma == 10 && gains[0] == 255 && gains[1] == 255 && gains[2] == 255 && brightness == 255;
+        }
+
+        inline void apply(rgb &value) const
+        {
+            value.red = table[0][value.red];
+            value.green = table[1][value.green];
+            value.blue = table[2][value.blue];
+        }
+
+        inline void apply(rgbw &value) const
+        {
+            value.red = table[0][value.red];
+            value.green = table[1][value.green];
+            value.blue = table[2][value.blue];
+            value.white = table[3][value.white];
+        }
+
+        uint8_t table[4][UINT8_MAX + 1];
+    };
 }
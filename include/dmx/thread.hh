@@ -2,50 +2,104 @@
 
 #include "prelude.hh"
 #include "dmx/transport.hh"
-#include "message_buffer.h"
 #include "util.hh"
 #include "cfg.hh"
 #include "task/lock.hh"
+#include "task/seqlock.hh"
+
+#ifndef DMX_SLOT_VALS_REFRESH_MSEC
+/* subscribers get unchanged slot values again after this long, 0 for never */
+#define DMX_SLOT_VALS_REFRESH_MSEC 1000
+#endif
 
 namespace dmx {
+    /**
+     * @brief The slot values of the latest DMX frame, as published by
+     *        `dmx::thread` for a subscriber to read.
+     */
+    struct slot_frame {
+        uint16_t n_vals;
+        uint8_t vals[MAX_USER_APP_SLOTS];
+    };
+
+    using slot_frame_lock = task::seqlock<slot_frame>;
+
     struct dmx_slot_vals {
         size_t n_vals;
         uint8_t const *vals;
+        /* the same values, for reading later from another task. Set by `dmx::thread`, one per subscriber. */
+        slot_frame_lock const *source;
     };
 
     using on_dmx_slot_vals_t = void (*)(void *, dmx_slot_vals const *, cfg::dmx_config_t const *);
 
     struct thread {
         constexpr thread():
-            rx_buffer {},
             packet_task_handle(nullptr),
             slot_vals_subs(nullptr),
-            packet_queue_handle(nullptr),
+            rx_transport(nullptr),
             dmx_config(),
-            slot_vals_subs_mutex(nullptr)
+            slot_vals_subs_mutex(nullptr),
+            windows_stale(true)
         {}
 
         struct on_dmx_slot_vals_sub {
             constexpr on_dmx_slot_vals_sub(on_dmx_slot_vals_t callback, void *context):
                 callback(callback),
                 context(context),
-                next(nullptr)
+                next(nullptr),
+                window_param(cfg::dmx::config),
+                has_window_param(false),
+                has_window(false),
+                window {},
+                is_current(false),
+                notified_at(0),
+                vals()
+            {}
+
+            constexpr on_dmx_slot_vals_sub(on_dmx_slot_vals_t callback, void *context, cfg::param<cfg::dmx_config_t> window_param):
+                callback(callback),
+                context(context),
+                next(nullptr),
+                window_param(window_param),
+                has_window_param(true),
+                has_window(false),
+                window {},
+                is_current(false),
+                notified_at(0),
+                vals()
             {}
+
             on_dmx_slot_vals_t callback;
             void *context;
             on_dmx_slot_vals_sub *next;
+            cfg::param<cfg::dmx_config_t> window_param;
+            bool has_window_param;
+            bool has_window;        /* whether `window` was loaded, instead of following the DMX config */
+            cfg::dmx_config_t window;
+            bool is_current;        /* whether `vals` is what `callback` last got */
+            TickType_t notified_at;
+            slot_frame_lock vals;
         };
 
         ret_code_t init();
 
-        /* sets the buffer that the thread will use to receive DMX/RDM packets */
-        void set_frame_buf(MessageBufferHandle_t queue);
+        /* sets the transport that the thread receives DMX/RDM packets from */
+        void set_transport(transport *tp);
 
         inline bool is_initialized()
         {
             return packet_task_handle != nullptr;
         }
 
+        /**
+         * @brief Subscribe to slot values and DMX config changes.
+         *
+         * `callback` is called when the values differ from the ones it got
+         * last, and with unchanged values every
+         * `DMX_SLOT_VALS_REFRESH_MSEC`. It gets the values again after the
+         * DMX config changes.
+         */
         ret_code_t on_dmx_slot_vals(void *context, on_dmx_slot_vals_t callback, TickType_t max_delay);
 
         inline ret_code_t on_dmx_slot_vals(void *context, on_dmx_slot_vals_t callback)
@@ -53,18 +107,34 @@ namespace dmx {
             return on_dmx_slot_vals(context, callback, portMAX_DELAY);
         }
 
+        /**
+         * @brief Subscribe to the slots in the window set by `window`,
+         *        instead of the DMX config.
+         *
+         * Each LED channel has its own window, see `cfg::led0::dmx_window`.
+         * Until the window is set, or while its channel is 0, the
+         * subscriber follows the DMX config. `callback` gets the window as
+         * its config.
+         */
+        ret_code_t on_dmx_slot_vals(void *context, on_dmx_slot_vals_t callback, cfg::param<cfg::dmx_config_t> window, TickType_t max_delay = portMAX_DELAY);
+
         ret_code_t send(dmx_slot_vals const *);
 
         void packet_task_func();
         void slot_vals_task_func();
     protected:
         void on_channel_cfg_update(cfg::dmx_config_t const *config);
-        uint8_t rx_buffer[DMX_MAX_FRAME_SIZE];
+        ret_code_t add_slot_vals_sub(on_dmx_slot_vals_sub const &sub, TickType_t max_delay);
+        void load_windows(cfg::dmx_config_t const *config);
+        size_t frame_size(cfg::dmx_config_t const *config);
+        void notify_sub(on_dmx_slot_vals_sub *sub, size_t n_vals, uint8_t const *vals, cfg::dmx_config_t const *config, TickType_t now);
+        void on_frame(uint8_t const *frame, size_t nread, cfg::dmx_config_t const *config);
         TaskHandle_t packet_task_handle;
         on_dmx_slot_vals_sub *slot_vals_subs;
-        MessageBufferHandle_t packet_queue_handle;
+        transport *rx_transport;
         // double_buf<cfg::dmx_config_t> dmx_config;
         task::lock<cfg::dmx_config_t> dmx_config;
         xSemaphoreHandle slot_vals_subs_mutex;
+        volatile bool windows_stale;
     };
 }
@@ -1,16 +1,51 @@
 #pragma once
 
 #include "prelude.hh"
-#include "message_buffer.h"
+#include "queue.h"
 #include "task.hh"
 
 #define DMX_MAX_FRAME_SIZE 520
 #define RDM_MAX_FRAME_SIZE 257
-#define DMX_MAX_QUEUED_FRAMES 8
+
+#ifndef DMX_MAX_QUEUED_ALT_FRAMES
+/* RDM and other frames with an alternate start code waiting for the packet
+ * task. Dimmer frames don't queue, only the latest one is kept. */
+#define DMX_MAX_QUEUED_ALT_FRAMES 2
+#endif
 
 namespace dmx {
+    /**
+     * @brief A received frame, in a buffer that the transport lends to the
+     *        packet task until it is released.
+     */
+    struct rx_frame {
+        uint8_t const *data;
+        size_t length;
+    };
+
     struct transport {
-        virtual MessageBufferHandle_t frame_buf() = 0;
+        /**
+         * @brief Take the next received frame.
+         *
+         * Frames with an alternate start code come in the order they were
+         * received. Of the dimmer frames, only the latest one that hasn't
+         * been taken yet is kept.
+         *
+         * @return NRF_ERROR_TIMEOUT if there was no frame within `max_delay`.
+         */
+        virtual ret_code_t receive(rx_frame *frame, TickType_t max_delay) = 0;
+
+        /* give the buffer of a frame taken with `receive` back to the transport */
+        virtual void release(rx_frame const &frame) = 0;
+
+        /**
+         * @brief Hand dimmer frames over as soon as their first `n_bytes`
+         *        bytes, start code included, are in.
+         *
+         * The rest of the frame is ignored. 0 waits for the end of the frame.
+         */
+        virtual void set_frame_size(size_t n_bytes) = 0;
+
         virtual ret_code_t enable() = 0;
         virtual ret_code_t disable() = 0;
     };
@@ -3,15 +3,13 @@
 #include "prelude.hh"
 #include "led/transport.hh"
 #include "led/transcode.hh"
+#include "led/render_loop.hh"
+#include "led/dirty_range.hh"
 #include "led/renderer.hh"
+#include "led/pipeline.hh"
+#include "led/arena.hh"
 #include "led/thread.hh"
 
 namespace led {
-    enum class color_mode: uint8_t {
-        rgb = 0,
-        hsv = 1,
-        hsl = 2,
-    };
-
     void reset_all();
 }
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "prelude.hh"
+
+#ifndef LED_ARENA_SIZE
+/* Bytes shared by every LED channel. The default holds the pixel buffers of
+ * MAX_LED_CHANNELS channels of MAX_LEDS_PER_THREAD LEDs. Frames that come
+ * without a buffer of their own are also placed here, so add room for them. */
+#define LED_ARENA_SIZE (MAX_LED_CHANNELS * MAX_LEDS_PER_THREAD * 3)
+#endif
+
+namespace led {
+    /**
+     * @brief One LED channel's share of the arena.
+     */
+    struct arena_slice {
+        uint8_t *ptr;
+        size_t len;     /* in bytes */
+        size_t n_leds;  /* that the slice was laid out for */
+    };
+
+    /* every region in the arena starts on a word, for EasyDMA and word-wise encoders */
+    constexpr size_t arena_align(size_t n)
+    {
+        return (n + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    }
+
+    /**
+     * @brief The arena, `LED_ARENA_SIZE` bytes of word-aligned RAM.
+     */
+    uint8_t *arena_base();
+
+    /**
+     * @brief Move the first `keep[i]` bytes of `from[i]` to `to[i]`, for `n`
+     *        regions that are in the same order before and after.
+     * 
+     * An old region may overlap any new one, as long as the old regions don't
+     * overlap each other, and neither do the new ones.
+     */
+    void arena_move(uint8_t * const *from, uint8_t * const *to, size_t const *keep, size_t n);
+}
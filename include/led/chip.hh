@@ -0,0 +1,124 @@
+#pragma once
+
+#include "prelude.hh"
+#include "color.hh"
+
+namespace led {
+    /* a color channel of an LED chip */
+    enum class channel: uint8_t {
+        red = 0,
+        green,
+        blue,
+        white,  /* sent as 0 for pixels without a white channel */
+    };
+
+    /**
+     * @brief The datasheet timing and color layout of a one-wire LED chip.
+     *
+     * Every bit is a high pulse followed by a low pulse, `period_ns` long in
+     * total. The chip tells 0 from 1 by the length of the high pulse. The low
+     * pulse only has to be long enough for the chip to see the next rising
+     * edge, and shorter than `reset_ns`.
+     *
+     * Chips with settings of their own take them in a header, which is sent
+     * the same way as the colors, after the bus reset and before the first
+     * LED of every frame.
+     */
+    struct chip {
+        uint16_t t0h_ns;            /* high time of a 0 bit */
+        uint16_t t1h_ns;            /* high time of a 1 bit */
+        uint16_t high_tolerance_ns; /* of both high times */
+        uint16_t period_ns;         /* of one bit */
+        uint16_t period_tolerance_ns;
+        uint16_t min_low_ns;        /* shortest low time the chip is specified for */
+        uint32_t reset_ns;          /* low time that latches a frame */
+        uint8_t n_channels;
+        channel order[4];           /* the first `n_channels` are sent, in this order */
+        uint8_t header_size;        /* bytes of `header`, 0 for chips without one */
+        uint8_t header[8];
+    };
+
+    inline uint8_t channel_value(color::rgb const &value, channel c)
+    {
+        switch (c) {
+        case channel::red: return value.red;
+        case channel::green: return value.green;
+        case channel::blue: return value.blue;
+        default: return 0;
+        }
+    }
+
+    inline uint8_t channel_value(color::rgbw const &value, channel c)
+    {
+        switch (c) {
+        case channel::red: return value.red;
+        case channel::green: return value.green;
+        case channel::blue: return value.blue;
+        case channel::white: return value.white;
+        default: return 0;
+        }
+    }
+
+    namespace chips {
+        /* The high times of the WS2812, which the WS2812B accepts too, and
+         * the low time of the WS2812B. The reset is long enough for every
+         * revision of either. */
+        struct ws2812 {
+            constexpr static chip spec = {
+                350, 700, 150, 1250, 600, 300, 1000000,
+                3, { channel::green, channel::red, channel::blue },
+                0, {}
+            };
+        };
+
+        /* WS2811 in its 800kHz mode */
+        struct ws2811 {
+            constexpr static chip spec = {
+                250, 600, 150, 1250, 300, 500, 50000,
+                3, { channel::red, channel::green, channel::blue },
+                0, {}
+            };
+        };
+
+        struct sk6812 {
+            constexpr static chip spec = {
+                300, 600, 150, 1250, 600, 450, 80000,
+                3, { channel::green, channel::red, channel::blue },
+                0, {}
+            };
+        };
+
+        struct sk6812_rgbw {
+            constexpr static chip spec = {
+                300, 600, 150, 1250, 600, 450, 80000,
+                4, { channel::green, channel::red, channel::blue, channel::white },
+                0, {}
+            };
+        };
+
+        /**
+         * @brief TM1814, which takes an inverted signal, so the strip has to
+         *        be driven through an inverting buffer.
+         *
+         * Every frame starts with the constant current setting of white,
+         * red, green and blue, and then the same 32 bits inverted, which
+         * the chip checks them against.
+         *
+         * @tparam Current Of every color, from 6.5mA at 0 to 38mA at 63, in
+         *                 steps of 0.5mA.
+         */
+        template<uint8_t Current>
+        struct tm1814 {
+            static_assert(Current <= 63);
+
+            constexpr static chip spec = {
+                360, 720, 150, 1250, 300, 380, 200000,
+                4, { channel::white, channel::red, channel::green, channel::blue },
+                8, {
+                    Current, Current, Current, Current,
+                    (uint8_t)~Current, (uint8_t)~Current, (uint8_t)~Current, (uint8_t)~Current,
+                }
+            };
+        };
+    }
+}
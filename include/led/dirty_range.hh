@@ -0,0 +1,157 @@
+#pragma once
+
+#include "prelude.hh"
+
+namespace led {
+    /**
+     * @brief LEDs that changed since a buffer was last encoded, `[first, end)`.
+     * 
+     * Marking two ranges keeps the span that covers both, so this may
+     * include LEDs that did not change, but never misses one that did.
+     */
+    struct dirty_range {
+        constexpr dirty_range():
+            first(0),
+            end(0)
+        {}
+
+        constexpr dirty_range(size_t first, size_t end):
+            first(first),
+            end(end)
+        {}
+
+        inline bool is_empty() const
+        {
+            return first >= end;
+        }
+
+        inline size_t len() const
+        {
+            return is_empty() ? 0 : end - first;
+        }
+
+        inline void mark(size_t from, size_t to)
+        {
+            if (from >= to) {
+                return;
+            } else if (is_empty()) {
+                first = from;
+                end = to;
+            } else {
+                first = std::min(first, from);
+                end = std::max(end, to);
+            }
+        }
+
+        inline void mark(dirty_range const &other)
+        {
+            mark(other.first, other.end);
+        }
+
+        inline void mark_all()
+        {
+            mark(0, SIZE_MAX);
+        }
+
+        inline void clear()
+        {
+            first = 0;
+            end = 0;
+        }
+
+        /* limit the range to the first `n` LEDs */
+        inline dirty_range clip(size_t n) const
+        {
+            return dirty_range(std::min(first, n), std::min(end, n));
+        }
+
+        size_t first;
+        size_t end;
+    };
+
+    /**
+     * @brief Dirty ranges of the last `N_FRAMES` frames, and the frame each
+     *        of up to `N_BUFFERS` buffers was last rendered in.
+     * 
+     * Buffers are not necessarily rendered in turn, so this finds what a
+     * given buffer is missing. A buffer that is older than the history, or
+     * hasn't been seen before, is missing everything.
+     */
+    template<size_t N_FRAMES, size_t N_BUFFERS>
+    struct dirty_history {
+        constexpr dirty_history():
+            frame(0),
+            ranges {},
+            buffers {}
+        {}
+
+        /**
+         * @brief Record the LEDs changed in a new frame that is rendered
+         *        into `buffer`.
+         * 
+         * @return The LEDs that must be rendered into `buffer`.
+         */
+        dirty_range update(void const *buffer, dirty_range const &dirty)
+        {
+            frame += 1;
+            ranges[frame % N_FRAMES] = dirty;
+
+            /* take the buffer's slot, or the one that was rendered least recently */
+            auto slot = &buffers[0];
+            for (auto &b: buffers) {
+                if (b.ptr == buffer) {
+                    slot = &b;
+                    break;
+                } else if (frame - b.frame > frame - slot->frame) {
+                    slot = &b;
+                }
+            }
+
+            auto const span = missing(*slot, buffer);
+            slot->ptr = buffer;
+            slot->frame = frame;
+
+            return span;
+        }
+
+        /**
+         * @brief Whether all `N_BUFFERS` buffers have been rendered, and
+         *        each has every change that was recorded.
+         */
+        bool is_clean() const
+        {
+            for (auto const &b: buffers) {
+                if (!b.ptr || !missing(b, b.ptr).is_empty()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    protected:
+        struct buffer_frame {
+            void const *ptr;
+            uint32_t frame;
+        };
+
+        dirty_range missing(buffer_frame const &b, void const *buffer) const
+        {
+            dirty_range span;
+
+            if (b.ptr != buffer || frame - b.frame > N_FRAMES) {
+                span.mark_all();
+                return span;
+            }
+
+            for (auto f = b.frame + 1; f != frame + 1; ++f) {
+                span.mark(ranges[f % N_FRAMES]);
+            }
+
+            return span;
+        }
+
+        uint32_t frame;
+        dirty_range ranges[N_FRAMES];
+        buffer_frame buffers[N_BUFFERS];
+    };
+}
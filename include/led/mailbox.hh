@@ -0,0 +1,137 @@
+#pragma once
+
+#include "prelude.hh"
+#include "led/transcode.hh"
+
+namespace led {
+    /* one frame being sent, the latest completed frame, and one being rendered */
+    constexpr size_t n_frame_buffers = 3;
+
+    packed_struct frame_counters {
+        uint32_t sent;      /* new frames handed to the transport */
+        uint32_t dropped;   /* completed frames replaced by a newer one before they were sent */
+        uint32_t repeated;  /* frames sent again because no new frame was ready */
+    };
+
+    /**
+     * @brief Triple buffer that always hands the latest completed frame to
+     *        a transport.
+     *
+     * The renderer and the transport each own one buffer, and the third
+     * holds the latest completed frame. Neither side ever waits for the
+     * other: publishing a frame replaces an unsent one, and taking a frame
+     * when none is ready leaves the last one in place.
+     */
+    struct frame_mailbox {
+        constexpr frame_mailbox(transcode *frame0, transcode *frame1, transcode *frame2):
+            frames {frame0, frame1, frame2},
+            sending(0),
+            ready(1),
+            rendering(2),
+            has_ready(false),
+            tags {},
+            counters {}
+        {}
+
+        inline transcode *frame(size_t idx)
+        {
+            assert(idx < n_frame_buffers);
+            return frames[idx];
+        }
+
+        /* the frame owned by the transport */
+        inline transcode *sent_frame()
+        {
+            return frames[sending];
+        }
+
+        /* the frame owned by the renderer */
+        inline transcode *render_target()
+        {
+            return frames[rendering];
+        }
+
+        /* the tag that was published with the frame owned by the transport */
+        inline uint32_t sent_tag() const
+        {
+            return tags[sending];
+        }
+
+        /* whether a completed frame is waiting for the transport */
+        inline bool is_pending() const
+        {
+            return has_ready;
+        }
+
+        /**
+         * @brief Make the render target the latest completed frame, and give
+         *        the renderer a free buffer.
+         *
+         * @param tag Stays with the frame, see `sent_tag`.
+         */
+        inline void publish(uint32_t tag = 0)
+        {
+            CRITICAL_REGION_ENTER();
+                if (has_ready) {
+                    counters.dropped += 1;
+                }
+                tags[rendering] = tag;
+                std::swap(ready, rendering);
+                has_ready = true;
+            CRITICAL_REGION_EXIT();
+        }
+
+        /**
+         * @brief Hand the latest completed frame to the transport.
+         *
+         * @return The new frame, or `nullptr` if no frame was completed since
+         *         the last call.
+         */
+        inline transcode *take()
+        {
+            transcode *result = nullptr;
+
+            CRITICAL_REGION_ENTER();
+                if (has_ready) {
+                    std::swap(sending, ready);
+                    has_ready = false;
+                    counters.sent += 1;
+                    result = frames[sending];
+                }
+            CRITICAL_REGION_EXIT();
+
+            return result;
+        }
+
+        /* forget the completed frame, e.g. because its buffer has moved */
+        inline void discard()
+        {
+            CRITICAL_REGION_ENTER();
+                if (has_ready) {
+                    counters.dropped += 1;
+                    has_ready = false;
+                }
+            CRITICAL_REGION_EXIT();
+        }
+
+        /* call this when the last frame is sent again instead of a new one */
+        inline void repeat()
+        {
+            counters.repeated += 1;
+        }
+
+        inline frame_counters get_counters() const
+        {
+            return counters;
+        }
+
+    protected:
+        transcode *frames[n_frame_buffers];
+        uint8_t sending;
+        uint8_t ready;
+        uint8_t rendering;
+        volatile bool has_ready;
+        uint32_t tags[n_frame_buffers];
+        frame_counters counters;
+    };
+}
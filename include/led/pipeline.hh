@@ -0,0 +1,186 @@
+#pragma once
+
+#include "prelude.hh"
+#include "led/mailbox.hh"
+
+#ifndef LED_PIPELINE_STATS
+/* Per-frame timing of LED threads. When this is 0, the probes compile to
+ * nothing and the meta service has no pipeline characteristic. */
+#ifdef NDEBUG
+#define LED_PIPELINE_STATS 0
+#else
+#define LED_PIPELINE_STATS 1
+#endif
+#endif
+
+/* the RTC that drives the FreeRTOS tick runs from LFCLK without a prescaler */
+#define LED_PIPELINE_RTC_HZ 32768
+
+namespace led {
+    enum class pipeline_stage: uint8_t {
+        render = 0, /* the whole renderer::render() call */
+        refresh,    /* userapp init/refresh, as reported by the renderer */
+        transcode,  /* pixel encoding, as reported by the renderer */
+        airtime,    /* transport::send() until the send completion interrupt */
+        slack,      /* time left in the refresh interval after the frame */
+        interval,   /* between the starts of two frames; max - min is the jitter */
+        latency,    /* input (DMX frame or BLE write) until its frame has been sent */
+        MAX
+    };
+
+    /* `wall_clock()` values are 24 bits, so this is never one of them */
+    constexpr uint32_t no_input = UINT32_MAX;
+
+    /* bin 0 counts spans below 2^10 cycles (16us at 64MHz), and every other
+     * bin is 4 times as wide as the one before it */
+    constexpr size_t pipeline_hist_bins = 8;
+
+    /**
+     * @brief Rolling timings of one pipeline stage, in CPU cycles.
+     */
+    packed_struct stage_stats {
+        uint32_t count;
+        uint32_t min;
+        uint32_t avg;   /* moving average over roughly the last 16 frames */
+        uint32_t max;
+        uint16_t hist[pipeline_hist_bins]; /* saturates at UINT16_MAX */
+
+        void record(uint32_t cycles);
+    };
+
+    /**
+     * @brief Timings of every stage of an LED thread. This is also the layout
+     *        of the meta service's pipeline stats characteristic.
+     */
+    packed_struct pipeline_stats {
+        uint32_t late;  /* frames that took longer than the refresh interval */
+        frame_counters frames;
+        stage_stats stages[(size_t)pipeline_stage::MAX];
+
+        inline void record(pipeline_stage stage, uint32_t cycles)
+        {
+            stages[(size_t)stage].record(cycles);
+        }
+    };
+
+    /**
+     * @brief Copy the timings of the LED thread that was initialized
+     *        `channel`th, and optionally start over.
+     *
+     * @return NRF_ERROR_INVALID_PARAM if there is no such thread, or
+     *         NRF_ERROR_NOT_SUPPORTED if LED_PIPELINE_STATS is 0.
+     */
+    ret_code_t pipeline_snapshot(size_t channel, pipeline_stats *out, bool clear);
+
+#if LED_PIPELINE_STATS
+    /**
+     * @brief Timing probes for one LED thread.
+     *
+     * CPU-bound stages are timed with the DWT cycle counter. It stops while
+     * the core sleeps, so spans that include waiting (airtime and slack) are
+     * timed with the RTC instead, and converted to cycles.
+     */
+    struct pipeline_probe {
+        constexpr pipeline_probe():
+            stats {},
+            tx_start(0),
+            tx_input(no_input),
+            frame_start(0),
+            has_frame(false)
+        {}
+
+        /**
+         * @brief Start the DWT cycle counter.
+         */
+        static void init();
+
+        static inline uint32_t cycles()
+        {
+            return DWT->CYCCNT;
+        }
+
+        static inline uint32_t wall_clock()
+        {
+            return portNRF_RTC_REG->COUNTER;
+        }
+
+        static inline uint32_t wall_to_cycles(uint32_t counts)
+        {
+            return (uint32_t)(((uint64_t)counts * SystemCoreClock) / LED_PIPELINE_RTC_HZ);
+        }
+
+        inline void record(pipeline_stage stage, uint32_t start)
+        {
+            stats.record(stage, cycles() - start);
+        }
+
+        inline void record_cycles(pipeline_stage stage, uint32_t n_cycles)
+        {
+            stats.record(stage, n_cycles);
+        }
+
+        /**
+         * @brief Record the interval since the last frame started.
+         * 
+         * @return The start of this frame, as a `wall_clock()` value.
+         */
+        inline uint32_t start_frame()
+        {
+            auto const now = wall_clock();
+            if (has_frame) {
+                stats.record(pipeline_stage::interval, wall_to_cycles((now - frame_start) & RTC_COUNTER_COUNTER_Msk));
+            }
+            frame_start = now;
+            has_frame = true;
+            return now;
+        }
+
+        /**
+         * @brief Start timing a send.
+         * 
+         * @param input When the oldest input shown in the frame arrived, as
+         *              a `wall_clock()` value, or `no_input`.
+         */
+        inline void start_tx(uint32_t input)
+        {
+            tx_start = wall_clock();
+            tx_input = input;
+        }
+
+        /* called from the send completion interrupt */
+        inline void end_tx()
+        {
+            auto const now = wall_clock();
+            stats.record(pipeline_stage::airtime, wall_to_cycles((now - tx_start) & RTC_COUNTER_COUNTER_Msk));
+            if (tx_input != no_input) {
+                stats.record(pipeline_stage::latency, wall_to_cycles((now - tx_input) & RTC_COUNTER_COUNTER_Msk));
+                tx_input = no_input;
+            }
+        }
+
+        /**
+         * @brief Record the slack of a frame that started at `start`
+         *        (a `wall_clock()` value) and is due `period` ticks later.
+         */
+        void record_slack(uint32_t start, TickType_t period);
+
+        pipeline_stats stats;
+        uint32_t tx_start;
+        uint32_t tx_input;
+        uint32_t frame_start;
+        bool has_frame;
+    };
+#else
+    struct pipeline_probe {
+        static inline void init() {}
+        static inline uint32_t cycles() { return 0; }
+        static inline uint32_t wall_clock() { return 0; }
+        inline void record(pipeline_stage, uint32_t) {}
+        inline void record_cycles(pipeline_stage, uint32_t) {}
+        inline uint32_t start_frame() { return 0; }
+        inline void start_tx(uint32_t) {}
+        inline void end_tx() {}
+        inline void record_slack(uint32_t, TickType_t) {}
+    };
+#endif
+}
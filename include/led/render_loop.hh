@@ -0,0 +1,119 @@
+#pragma once
+
+#include "prelude.hh"
+#include "color.hh"
+
+namespace led {
+    enum class color_mode: uint8_t {
+        rgb = 0,
+        hsv = 1,
+        hsl = 2,
+    };
+
+    /**
+     * @brief Convert `n` pixels to RGB, and encode them into `out`.
+     * 
+     * Pixels have one byte per color channel of the strip. The color mode
+     * applies to the first three, and on strips with a white channel, the
+     * fourth is white. Loops that were selected with `corrected` run each
+     * color through `lut` on its way to the encoder. Other loops ignore it.
+     */
+    using render_loop_t = void (*)(uint8_t *out, uint8_t const *pixels, size_t n, color::correction const *lut);
+
+    template<color_mode Mode>
+    inline void pixel_to_rgb(uint8_t const *p, color::rgb &result);
+
+    template<>
+    inline void pixel_to_rgb<color_mode::rgb>(uint8_t const *p, color::rgb &result)
+    {
+        result.red = p[0];
+        result.green = p[1];
+        result.blue = p[2];
+    }
+
+    template<>
+    inline void pixel_to_rgb<color_mode::hsv>(uint8_t const *p, color::rgb &result)
+    {
+        color::hsv(p[0], p[1], p[2]).to_rgb(result, color::curve::ws2812);
+    }
+
+    template<>
+    inline void pixel_to_rgb<color_mode::hsl>(uint8_t const *p, color::rgb &result)
+    {
+        color::hsl(p[0], p[1], p[2]).to_rgb(result, color::curve::ws2812);
+    }
+
+    /**
+     * @brief Render loop for one color mode and one transcoder.
+     * 
+     * `Encoder` must have a static `encode_led`, `bytes_per_led` and
+     * `channels`, and take `color::rgbw` if it has 4 channels. This should
+     * be instantiated in the same file as `Encoder::encode_led`, so that it
+     * is inlined into the loop.
+     * 
+     * @tparam ExtractWhite Move the white that red, green and blue have in
+     *                      common to the white channel, see
+     *                      `color::extract_white`.
+     */
+    template<color_mode Mode, bool Corrected, bool ExtractWhite, typename Encoder>
+    void render_loop(uint8_t *out, uint8_t const *pixels, size_t n, color::correction const *lut)
+    {
+        unused(lut);
+
+        constexpr size_t channels = Encoder::channels;
+        static_assert(channels == 3 || channels == 4);
+
+        for (size_t i = 0; i < n; ++i, pixels += channels, out += Encoder::bytes_per_led) {
+            color::rgb value;
+            pixel_to_rgb<Mode>(pixels, value);
+
+            if constexpr (channels == 4) {
+                auto with_white = color::rgbw(value, pixels[3]);
+                if (ExtractWhite) {
+                    color::extract_white(with_white);
+                }
+                if (Corrected) {
+                    lut->apply(with_white);
+                }
+                Encoder::encode_led(with_white, out);
+            } else {
+                if (Corrected) {
+                    lut->apply(value);
+                }
+                Encoder::encode_led(value, out);
+            }
+        }
+    }
+
+    /**
+     * @brief Look up the render loop for `mode`, with or without color
+     *        correction and white extraction.
+     * 
+     * White extraction is ignored for encoders without a white channel.
+     * 
+     * @return nullptr if `mode` is not a known color mode.
+     */
+    template<typename Encoder>
+    render_loop_t select_render_loop(color_mode mode, bool corrected, bool extract_white)
+    {
+        /* a strip without a white channel has one set of loops, not two */
+        constexpr bool X = Encoder::channels == 4;
+
+        static constexpr render_loop_t loops[][2][2] = {
+            {
+                { render_loop<color_mode::rgb, false, false, Encoder>, render_loop<color_mode::rgb, false, X, Encoder> },
+                { render_loop<color_mode::rgb, true, false, Encoder>, render_loop<color_mode::rgb, true, X, Encoder> },
+            },
+            {
+                { render_loop<color_mode::hsv, false, false, Encoder>, render_loop<color_mode::hsv, false, X, Encoder> },
+                { render_loop<color_mode::hsv, true, false, Encoder>, render_loop<color_mode::hsv, true, X, Encoder> },
+            },
+            {
+                { render_loop<color_mode::hsl, false, false, Encoder>, render_loop<color_mode::hsl, false, X, Encoder> },
+                { render_loop<color_mode::hsl, true, false, Encoder>, render_loop<color_mode::hsl, true, X, Encoder> },
+            },
+        };
+
+        return (size_t)mode < sizeof(loops) / sizeof(loops[0]) ? loops[(size_t)mode][corrected][extract_white] : nullptr;
+    }
+}
@@ -5,15 +5,79 @@
 #include "cfg.hh"
 
 namespace led {
+    struct thread;
+
     struct renderer_props {
         cfg::led_render_t render_config;
         cfg::dmx_config_t dmx_config;
         uint8_t dmx_vals[MAX_USER_APP_SLOTS];
+        uint16_t max_frame_rate;    /* see `thread::max_frame_rate` */
+        uint16_t refresh_msec;      /* see `thread::refresh_interval_msec` */
+    };
+
+    struct render_stats {
+        uint32_t frames;
+        uint32_t pixels_encoded;        /* in the last frame */
+        uint32_t total_pixels_encoded;
+        uint32_t refresh_cycles;        /* in the last frame, 0 if LED_PIPELINE_STATS is 0 */
+        uint32_t transcode_cycles;      /* in the last frame, 0 if LED_PIPELINE_STATS is 0 */
     };
 
     struct renderer {
         virtual ret_code_t render(led::transcode *transcoder, renderer_props const &props) = 0;
         virtual ret_code_t init_render(renderer_props const &props) = 0;
+
+        virtual render_stats stats()
+        {
+            return render_stats {};
+        }
+
+        /**
+         * @brief Tell the LED thread that new input is ready to be rendered.
+         * 
+         * In genlock mode this renders a frame as soon as the strip allows,
+         * instead of at the next refresh interval. Call this from task
+         * context only.
+         */
+        void commit();
+
+        /**
+         * @brief Whether rendering now, with unchanged props, would produce
+         *        the same frame that is already in both buffers.
+         */
+        virtual bool is_idle()
+        {
+            return false;
+        }
+
+        /**
+         * @brief Bytes per LED that the renderer keeps in the LED arena, for
+         *        a strip with `channels` colors per LED.
+         */
+        virtual size_t arena_bytes_per_led(size_t channels)
+        {
+            unused(channels);
+            return 0;
+        }
+
+        /**
+         * @brief Move the renderer's pixels to `pixels`, which has room for
+         *        `n_leds` LEDs of `channels` colors each.
+         * 
+         * Called by the LED scheduler with interrupts disabled, after the
+         * old pixels were copied over. Any LEDs that the old buffer didn't
+         * have are zero. `pixels` is nullptr if `n_leds` is 0.
+         */
+        virtual void set_arena(uint8_t *pixels, size_t n_leds, size_t channels)
+        {
+            unused(pixels);
+            unused(n_leds);
+            unused(channels);
+        }
+
+        /* set by `thread::set_renderer` */
+        thread *owner = nullptr;
+
         // /* Load the renderer configuration from the `cfg` component. */
         // virtual ret_code_t prepare_config() = 0;
         // /* Send updated renderer configuration to the `cfg` component, if necessary. */
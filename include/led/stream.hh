@@ -0,0 +1,95 @@
+#pragma once
+
+#include "prelude.hh"
+#include "led/transcode.hh"
+#include "color.hh"
+
+#ifndef LED_STREAM_CHUNK_SIZE
+/* Size of each of the two DMA chunks owned by a stream. At 8MHz SPI, one
+ * byte takes 1us on the wire, so this is also the refill deadline in us. */
+#define LED_STREAM_CHUNK_SIZE 240
+#endif
+
+#ifndef LED_STREAM_MIN_REFILL_US
+/* Shortest time a chunk may take on the wire, which is how long the
+ * transport has to refill the other one. Faster transports need larger
+ * chunks, 4 times as large at 32MHz SPI. */
+#define LED_STREAM_MIN_REFILL_US 240
+#endif
+
+namespace led {
+    /**
+     * @brief A frame of RGB or RGBW pixels that is encoded while it is being
+     *        sent.
+     *
+     * Instead of encoding a whole frame up front, a transport calls `fill`
+     * every time one of the two chunks has been sent. The bytes produced are
+     * identical to those produced by calling `encoder->write_frame_start()`,
+     * `encoder->write()` for every pixel, and `encoder->write_bus_reset()`.
+     *
+     * `fill` is called from interrupt context, so the encoder must not block.
+     */
+    struct stream {
+        constexpr stream(transcode *encoder):
+            encoder(encoder),
+            pixels(nullptr),
+            n_pixels(0),
+            pos(0),
+            chunks {}
+        {}
+
+        /**
+         * @brief Set the pixels to be sent, and rewind the stream.
+         * 
+         * Pixels have `channels()` bytes each.
+         */
+        void set_frame(uint8_t const *pixels, size_t n_pixels);
+
+        inline void rewind()
+        {
+            pos = 0;
+        }
+
+        /**
+         * @brief Encode the next part of the frame into chunk `idx`.
+         *
+         * @return The number of bytes written to the chunk. 0 once the whole
+         *         frame has been handed out.
+         */
+        size_t fill(size_t idx);
+
+        /**
+         * @brief Whether a transport that sends `byte_rate` bytes per second
+         *        has at least LED_STREAM_MIN_REFILL_US to refill a chunk.
+         */
+        static constexpr bool keeps_up(uint32_t byte_rate)
+        {
+            return (uint64_t)LED_STREAM_CHUNK_SIZE * 1000000 >= (uint64_t)LED_STREAM_MIN_REFILL_US * byte_rate;
+        }
+
+        /* color channels per pixel, those of the encoder */
+        inline size_t channels()
+        {
+            return encoder->channels();
+        }
+
+        /* bytes in the whole frame, including both bus resets and the header */
+        inline size_t length()
+        {
+            return 2 * encoder->reset_size() + encoder->header_size() + n_pixels * encoder->led_size();
+        }
+
+        inline uint8_t *chunk(size_t idx)
+        {
+            assert(idx < 2);
+            return chunks[idx];
+        }
+
+    protected:
+        transcode *encoder;
+        uint8_t const *pixels;
+        size_t n_pixels;
+        size_t pos;
+        uint8_t chunks[2][LED_STREAM_CHUNK_SIZE];
+    };
+}
@@ -3,71 +3,312 @@
 #include "prelude.hh"
 #include "led/transport.hh"
 #include "led/transcode.hh"
+#include "led/stream.hh"
 #include "led/renderer.hh"
+#include "led/mailbox.hh"
+#include "led/pipeline.hh"
+#include "led/arena.hh"
 #include "cfg.hh"
 #include "dmx.hh"
 
+#ifndef LED_SKIP_IDLE_FRAMES
+#define LED_SKIP_IDLE_FRAMES 0
+#endif
+
+#ifndef LED_GENLOCK
+/* 1 renders a frame for every DMX frame or BLE write, see `thread::set_genlock` */
+#define LED_GENLOCK 0
+#endif
+
+#ifndef LED_SCHEDULER_STACK_SIZE
+/* in words, shared by every LED channel */
+#define LED_SCHEDULER_STACK_SIZE 320
+#endif
+
+/* `cfg::led_render_t::refresh_msec` that sends frames as fast as the strip allows */
+#define LED_REFRESH_AUTO 0
+
+#ifndef LED_AUTO_RENDER_SHARE
+/* in percent, the most CPU time that channels in LED_REFRESH_AUTO leave
+ * rendering all channels, so that lower priority tasks still run */
+#define LED_AUTO_RENDER_SHARE 50
+#endif
+
+#ifndef LED_IDLE_KEEPALIVE_MSEC
+/* 0 disables the keep-alive */
+#define LED_IDLE_KEEPALIVE_MSEC 1000
+#endif
+
 namespace led {
     struct thread {
-        constexpr thread(transcode *transcoder0, transcode *transcoder1, transport *transport, cfg::param<cfg::led_render_t> *render_config_param):
-            handle(nullptr),
+        /**
+         * @brief Create an LED thread that renders into three transcoders.
+         * 
+         * One is being sent, one holds the latest completed frame, and one
+         * is being rendered, so rendering never waits for the transport.
+         */
+        constexpr thread(transcode *transcoder0, transcode *transcoder1, transcode *transcoder2, transport *transport, cfg::param<cfg::led_render_t> *render_config_param):
+            tp(transport),
+            frames(transcoder0, transcoder1, transcoder2),
+            strm(nullptr),
+            segs {},
+            refresh_msec(DEFAULT_REFRESH_RATE_MSEC),
+            render(nullptr),
+            render_config_param(render_config_param),
+            render_config {},
+            dmx_config {},
+            dmx_source(nullptr),
+            dmx_version(0),
+            skip_idle(LED_SKIP_IDLE_FRAMES),
+            keepalive_msec(LED_IDLE_KEEPALIVE_MSEC),
+            inputs_changed(true),
+            probe {},
+            enabled(false),
+            started(false),
+            has_sent(false),
+            deadline(0),
+            last_send(0),
+            props {},
+            genlock(LED_GENLOCK),
+            triggered(false),
+            trigger_tick(0),
+            input_pending(false),
+            input_at(no_input),
+            last_render(0),
+            min_interval(1),
+            render_cost(0),
+            slice {},
+            arena_frames(0)
+        {}
+
+        /**
+         * @brief Create a streaming LED thread.
+         * 
+         * Frames are rendered into `frame0`, `frame1` and `frame2` as plain
+         * RGB or RGBW, and encoded in small chunks by the transport while they are
+         * being sent.
+         * Memory for encoded data is `sizeof(stream)`, regardless of the
+         * length of the LED strip.
+         */
+        constexpr thread(stream *stream, pixel_frame *frame0, pixel_frame *frame1, pixel_frame *frame2, transport *transport, cfg::param<cfg::led_render_t> *render_config_param):
             tp(transport),
-            tc {transcoder0, transcoder1},
+            frames(frame0, frame1, frame2),
+            strm(stream),
+            segs {},
             refresh_msec(DEFAULT_REFRESH_RATE_MSEC),
             render(nullptr),
             render_config_param(render_config_param),
             render_config {},
             dmx_config {},
-            dmx_vals {}
+            dmx_source(nullptr),
+            dmx_version(0),
+            skip_idle(LED_SKIP_IDLE_FRAMES),
+            keepalive_msec(LED_IDLE_KEEPALIVE_MSEC),
+            inputs_changed(true),
+            probe {},
+            enabled(false),
+            started(false),
+            has_sent(false),
+            deadline(0),
+            last_send(0),
+            props {},
+            genlock(LED_GENLOCK),
+            triggered(false),
+            trigger_tick(0),
+            input_pending(false),
+            input_at(no_input),
+            last_render(0),
+            min_interval(1),
+            render_cost(0),
+            slice {},
+            arena_frames(0)
         {}
 
         void set_renderer(renderer *render);
 
-        inline void enable()
+        /**
+         * @brief Skip rendering and sending frames when nothing has changed.
+         * 
+         * A frame is idle when the DMX values, DMX config and render config
+         * are unchanged, and the renderer reports that it is idle. Idle
+         * frames are neither rendered nor sent, except that the last frame
+         * is re-sent every `keepalive_msec` (0 to never re-send it).
+         */
+        inline void set_skip_idle(bool enable, uint32_t keepalive_msec)
+        {
+            skip_idle = enable;
+            this->keepalive_msec = keepalive_msec;
+            inputs_changed = true;
+        }
+
+        /**
+         * @brief Render on input instead of on a fixed grid.
+         * 
+         * In genlock mode, every DMX frame or renderer commit renders a frame
+         * as soon as the previous one has had time to go out on the wire,
+         * and sends it as soon as the transport is free. Without input,
+         * frames are still rendered every refresh interval.
+         */
+        inline void set_genlock(bool enable)
         {
-            vTaskResume(handle);
+            genlock = enable;
         }
 
+        /**
+         * @brief New input is ready. Call this from task context only.
+         */
+        void trigger();
+
+        void enable();
+
         inline bool is_enabled()
         {
-            TaskStatus_t status = {};
-            vTaskGetInfo(handle, &status, pdFALSE, eInvalid);
-            return status.eCurrentState != eSuspended;
+            return enabled;
         }
 
         inline void update(dmx::dmx_slot_vals const *vals, cfg::dmx_config_t const *config)
         {
             if (config) {
+                if (memcmp(&dmx_config, config, sizeof(dmx_config)) != 0) {
+                    inputs_changed = true;
+                }
                 dmx_config = *config;
             }
 
+            /* the values themselves are read from `source` when the next frame is rendered */
             if (vals) {
-                memcpy(dmx_vals, vals->vals, vals->n_vals);
-                if (vals->n_vals < sizeof(dmx_vals)) {
-                    memset(&dmx_vals[vals->n_vals], 0, sizeof(dmx_vals) - vals->n_vals);
-                }
+                assert(vals->source != nullptr);
+                dmx_source = vals->source;
+                trigger();
             }
         }
 
+        /**
+         * @brief Frames sent, dropped and repeated since the thread started.
+         */
+        inline frame_counters counters() const
+        {
+            return frames.get_counters();
+        }
+
+        /**
+         * @brief Register the channel with the LED scheduler.
+         * 
+         * The first call creates the scheduler task, which serves every
+         * channel. Channels are not served until they are enabled.
+         */
         ret_code_t init(char const *name);
 
-        void task_func();
+        /* called by the LED scheduler */
+        void start();
+        void run_frame(TickType_t now);
+        TickType_t next_deadline(TickType_t now);
+
+        inline bool is_started() const
+        {
+            return started;
+        }
+
+        /**
+         * @brief The shortest interval between frames, in ticks.
+         * 
+         * Frames are rendered while the last one is being sent, so this is
+         * the longer of the airtime of the last frame and the recent render
+         * time. Other channels share the CPU, so with several busy channels
+         * the real limit may be lower.
+         */
+        TickType_t frame_floor() const;
+
+        /**
+         * @brief The most LEDs this channel could have, if the other channels
+         *        keep theirs.
+         */
+        size_t max_leds();
+
+        /**
+         * @brief Split the LED arena between the started channels, by their
+         *        number of LEDs.
+         * 
+         * Each channel's renderer pixels come first, followed by any of its
+         * frames that were created without a buffer. Channels keep their
+         * pixels, and get a blank frame. Channels are laid out in the order
+         * they were initialized, and if the arena is too small, the last
+         * ones get fewer LEDs than they asked for. Called by the LED
+         * scheduler, whenever a channel is started or its number of LEDs
+         * changes.
+         */
+        static void repartition_arena();
+
+        /* color channels per LED of the strip */
+        inline size_t channels()
+        {
+            return strm ? strm->channels() : frames.frame(0)->channels();
+        }
+
+        /* in frames per second, see `frame_floor` */
+        inline uint16_t max_frame_rate() const
+        {
+            return (uint16_t)std::min<TickType_t>(configTICK_RATE_HZ / frame_floor(), UINT16_MAX);
+        }
+
+        /* in milliseconds, the interval between frames that is in use, also in LED_REFRESH_AUTO */
+        inline uint16_t refresh_interval_msec() const
+        {
+            return (uint16_t)std::min<uint32_t>((period() * 1000 + configTICK_RATE_HZ / 2) / configTICK_RATE_HZ, UINT16_MAX);
+        }
 
     protected:
         void on_send_complete(BaseType_t *do_context_switch);
         void on_render_config_change(cfg::led_render_t *config);
+        ret_code_t set_frame(transcode *frame);
+        void set_airtime(size_t n_bytes);
+        void send_latest(TickType_t now);
+        void render_latest();
+        void record_render_cost(uint32_t counts);
+        TickType_t render_ticks() const;
+        TickType_t period() const;
+        size_t pixel_bytes(size_t n_leds);
+        size_t arena_bytes(size_t n_leds);
+        size_t arena_fit(size_t n_bytes);
+        void place(arena_slice const &to);
+        void blank_sent_frame(size_t n_leds);
+        void wait_until_sent();
 
-        TaskHandle_t handle;
         transport *tp;
-        transcode *tc[2];
+        frame_mailbox frames;
+        stream *strm;
+        segment segs[4];            /* bus reset, header, pixels and bus reset */
         BaseType_t refresh_msec;
         renderer *render;
         cfg::param<cfg::led_render_t> *render_config_param;
         cfg::led_render_t render_config;
         cfg::dmx_config_t dmx_config;
-        uint8_t dmx_vals[MAX_USER_APP_SLOTS];
+        dmx::slot_frame_lock const *dmx_source;
+        uint32_t dmx_version;       /* of the values in `props` */
+        bool skip_idle;
+        uint32_t keepalive_msec;
+        volatile bool inputs_changed;
+        pipeline_probe probe;
+        volatile bool enabled;
+        bool started;
+        bool has_sent;
+        TickType_t deadline;
+        TickType_t last_send;
+        renderer_props props;
+        bool genlock;
+        volatile bool triggered;
+        TickType_t trigger_tick;
+        volatile bool input_pending;
+        uint32_t input_at;
+        TickType_t last_render;
+        TickType_t min_interval;    /* airtime of the last frame sent, at least 1 tick */
+        uint32_t render_cost;       /* recent render time, in RTC counts */
+        arena_slice slice;
+        uint8_t arena_frames;       /* bit i is set if `frames.frame(i)` is in the arena */
+
+        friend ret_code_t pipeline_snapshot(size_t channel, pipeline_stats *out, bool clear);
     };
 
-    /* every LED thread is suspended by default. Resume them by calling this function. */
+    /* every LED thread is disabled by default. Enable them all by calling this function. */
     void resume_all();
 }
@@ -3,11 +3,19 @@
 #include "prelude.hh"
 #include "util.hh"
 #include "color.hh"
+#include "led/render_loop.hh"
 
 namespace led {
     struct transcode {
         constexpr transcode(buffer &buf):
-            output(buf)
+            output(buf),
+            omit_reset(false)
+        {}
+
+        /* for transcoders that are only used through `encode` */
+        constexpr transcode():
+            output(nullptr, 0),
+            omit_reset(false)
         {}
 
         inline void clear()
@@ -25,11 +33,208 @@ namespace led {
             return output.len();
         }
 
-        virtual ret_code_t write_bus_reset() = 0;
+        /**
+         * @brief Give the transcoder a different output buffer, which starts
+         *        out empty.
+         */
+        inline void set_output(uint8_t *p, size_t length)
+        {
+            output = buffer(p, length);
+        }
+
+        /* bytes of output for `n` LEDs, plus the bus resets and the header unless they are omitted */
+        inline size_t bytes_for(size_t n)
+        {
+            return n * led_size() + (omit_reset ? 0 : 2 * reset_size() + header_size());
+        }
+
+        /* LEDs that fit in the output buffer */
+        inline size_t max_leds()
+        {
+            auto const resets = bytes_for(0);
+            return output.max_len() > resets ? (output.max_len() - resets) / led_size() : 0;
+        }
+
+        /**
+         * @brief Leave bus resets and the header out of the output buffer.
+         * 
+         * Used when the transport sends the bus resets from `led::zeros`,
+         * and the header from `header()`, so that only pixel data is stored
+         * in the output buffer.
+         */
+        inline void omit_bus_reset(bool omit)
+        {
+            omit_reset = omit;
+        }
+
+        virtual ret_code_t write_bus_reset()
+        {
+            return omit_reset ? NRF_SUCCESS : output.fill(0, reset_size());
+        }
+
+        /**
+         * @brief Write what comes before the first LED of a frame: the bus
+         *        reset, and the header of chips that have one.
+         * 
+         * A frame ends with `write_bus_reset`.
+         */
+        inline ret_code_t write_frame_start()
+        {
+            auto ret = write_bus_reset();
+            VERIFY_SUCCESS(ret);
+
+            return omit_reset || header_size() == 0 ? NRF_SUCCESS : output.write(header(), header_size());
+        }
 
         virtual ret_code_t write(color::rgb &value) = 0;
 
+        /**
+         * @brief Reserve room for `n` LEDs in the output buffer.
+         * 
+         * @return A pointer to `n * led_size()` bytes, to be filled by
+         *         `encode`. nullptr if the output buffer is too small.
+         */
+        inline uint8_t *reserve(size_t n)
+        {
+            return output.reserve(n * led_size());
+        }
+
+        /**
+         * @brief Write `n` pixels, with one bounds check for all of them.
+         */
+        inline ret_code_t write_span(color::rgb const *values, size_t n)
+        {
+            auto out = reserve(n);
+            if (!out) {
+                return NRF_ERROR_INVALID_LENGTH;
+            }
+
+            encode(values, n, out);
+
+            return NRF_SUCCESS;
+        }
+
+        /**
+         * @brief Encode `n` pixels into `out`, bypassing the output buffer.
+         * 
+         * `out` must have room for `n * led_size()` bytes. This may be called
+         * from interrupt context.
+         */
+        virtual void encode(color::rgb const *values, size_t n, uint8_t *out) = 0;
+
+        /**
+         * @brief Same as `encode`, for pixels with a white channel.
+         * 
+         * Transcoders without a white channel drop it.
+         */
+        virtual void encode_rgbw(color::rgbw const *values, size_t n, uint8_t *out)
+        {
+            color::rgb batch[16];
+
+            for (size_t i = 0; i < n; i += sizeof(batch) / sizeof(batch[0])) {
+                auto const count = std::min(n - i, sizeof(batch) / sizeof(batch[0]));
+                for (size_t j = 0; j < count; ++j) {
+                    batch[j] = color::rgb(values[i + j].red, values[i + j].green, values[i + j].blue);
+                }
+                encode(batch, count, &out[i * led_size()]);
+            }
+        }
+
+        /**
+         * @brief Get the render loop specialized for `mode` and this
+         *        transcoder, which writes `led_size()` bytes per pixel.
+         * 
+         * @param corrected Whether the loop applies a `color::correction`.
+         * @param extract_white Whether the loop moves white from red, green
+         *                      and blue to the white channel.
+         * @return nullptr if there is none, use `encode` instead.
+         */
+        virtual render_loop_t render_loop(color_mode mode, bool corrected, bool extract_white)
+        {
+            unused(mode);
+            unused(corrected);
+            unused(extract_white);
+            return nullptr;
+        }
+
+        /* color channels per LED: 3, or 4 for strips with a white channel */
+        virtual size_t channels()
+        {
+            return 3;
+        }
+
+        /* number of bytes written by `write` */
+        virtual size_t led_size() = 0;
+
+        /* number of bytes written by `write_bus_reset` */
+        virtual size_t reset_size() = 0;
+
+        /**
+         * @brief Bytes that the chips take after the bus reset, before the
+         *        first LED, nullptr if they take none.
+         * 
+         * In RAM, so that transports can send it as it is.
+         */
+        virtual uint8_t const *header()
+        {
+            return nullptr;
+        }
+
+        /* number of bytes of `header` */
+        virtual size_t header_size()
+        {
+            return 0;
+        }
+
     protected:
         buffer output;
+        bool omit_reset;
+    };
+
+    /**
+     * @brief Stores rendered pixels as plain RGB or RGBW, without encoding
+     *        them.
+     * 
+     * Used as the frame buffers of a streaming `led::thread`, where the
+     * transport encodes the frame while sending it. The thread gives it the
+     * channel count of the stream's encoder.
+     */
+    struct pixel_frame: transcode {
+        constexpr pixel_frame(buffer &buf):
+            transcode(buf),
+            n_channels(sizeof(color::rgb))
+        {}
+
+        ret_code_t write(color::rgb &value) override;
+
+        void encode(color::rgb const *values, size_t n, uint8_t *out) override;
+
+        void encode_rgbw(color::rgbw const *values, size_t n, uint8_t *out) override;
+
+        render_loop_t render_loop(color_mode mode, bool corrected, bool extract_white) override;
+
+        size_t channels() override
+        {
+            return n_channels;
+        }
+
+        inline void set_channels(size_t channels)
+        {
+            assert(channels == 3 || channels == 4);
+            n_channels = channels;
+        }
+
+        size_t led_size() override
+        {
+            return n_channels;
+        }
+
+        size_t reset_size() override
+        {
+            return 0;
+        }
+
+    protected:
+        size_t n_channels;
     };
 }
@@ -1,8 +1,29 @@
 #pragma once
 
 #include "prelude.hh"
+#include "led/stream.hh"
+
+#ifndef LED_ZERO_REGION_SIZE
+/* must be at least the largest bus reset of any transcoder */
+#define LED_ZERO_REGION_SIZE 1000
+#endif
 
 namespace led {
+    /**
+     * @brief Zero bytes shared by every transport, for sending bus resets.
+     * 
+     * This is in RAM because EasyDMA can't read from flash. Never write to it.
+     */
+    extern uint8_t zeros[LED_ZERO_REGION_SIZE];
+
+    /**
+     * @brief One part of a frame sent with `transport::set_segments`.
+     */
+    struct segment {
+        uint8_t const *data;
+        size_t length;
+    };
+
     struct transport {
         /**
          * @brief Callback that fires when a transport has finished sending a unit of data.
@@ -19,9 +40,40 @@ namespace led {
          * the buffer set by this function.
          */
         virtual ret_code_t set_buffer(uint8_t *buffer, size_t length) = 0;
+
+        /**
+         * @brief Set the next stream to be sent by the transport.
+         * 
+         * Like `set_buffer`, this does not transmit data. The stream replaces
+         * any buffer set by `set_buffer`, and vice versa. The completion
+         * callback receives `nullptr` and 0 for a stream.
+         * 
+         * @return NRF_ERROR_NOT_SUPPORTED if the transport is too fast to
+         *         refill the stream's chunks in time, see `stream::keeps_up`.
+         */
+        virtual ret_code_t set_stream(stream *stream) = 0;
+
+        /**
+         * @brief Set the next list of segments to be sent by the transport.
+         * 
+         * The segments are sent back to back, as if they were one buffer.
+         * Neither the list nor the data it points to may change until the
+         * completion callback fires. The completion callback receives
+         * `nullptr` and 0.
+         */
+        virtual ret_code_t set_segments(segment const *segments, size_t n) = 0;
+
         virtual ret_code_t send() = 0;
 
         virtual ret_code_t on_send_complete(void *context, send_complete_t callback) = 0;
         virtual bool is_ready() = 0;
+
+        /**
+         * @brief Bytes sent per second, or 0 if unknown.
+         */
+        virtual uint32_t byte_rate()
+        {
+            return 0;
+        }
     };
 }
@@ -3,8 +3,16 @@
 #include "prelude.hh"
 #include "led/transport.hh"
 #include "led/transcode.hh"
+#include "led/arena.hh"
+#include "periph/spi_encoding.hh"
 #include "sdk_config.h"
 
+#ifndef LED_APA102_MAX_LEDS
+/* the longest APA102 strip, which sizes its end frame. Every LED of a
+ * channel in the arena takes at least 4 bytes of it. */
+#define LED_APA102_MAX_LEDS (LED_ARENA_SIZE / 4)
+#endif
+
 namespace spi {
     using pin = uint8_t;
 
@@ -24,11 +32,13 @@ namespace spi {
         MAX_SPIM_INST
     };
 
+    /* new frequencies go last, so that a zeroed `spi_init` stays at 8MHz */
     enum spi_frequency: uint32_t {
         // FREQ_4M,
         FREQ_8M,
-        // FREQ_16M,
-        // FREQ_32M,
+        FREQ_16M,   /* SPIM3 only */
+        FREQ_32M,   /* SPIM3 only */
+        FREQ_2M67,
     };
 
     struct spi_init {
@@ -46,60 +56,269 @@ namespace spi {
 
         ret_code_t set_buffer(uint8_t *buffer, size_t length) override;
 
+        ret_code_t set_stream(led::stream *stream) override;
+
+        ret_code_t set_segments(led::segment const *segments, size_t n) override;
+
         ret_code_t send() override;
 
         ret_code_t on_send_complete(void *context, send_complete_t callback) override;
 
         bool is_ready() override;
 
+        uint32_t byte_rate() override;
+
         inline id instance_id()
         {
             return inst_id;
         }
 
     protected:
+        ret_code_t send_chain();
 
         id inst_id;
     };
 
+    /* length of one SPI bit, in picoseconds */
+    constexpr uint32_t bit_ps(spi_frequency frequency)
+    {
+        switch (frequency) {
+        case FREQ_2M67: return 375000;
+        case FREQ_8M: return 125000;
+        case FREQ_16M: return 62500;
+        case FREQ_32M: return 31250;
+        }
+        return 0;
+    }
+
     /**
-     * @brief Transcode LED data for transmission to WS2812 over 8MHZ SPI.
+     * @brief A transcoder around a static `Encoder`, which has what
+     *        `led::render_loop` needs plus `bytes_per_reset`,
+     *        `bytes_per_header` and `header()`.
      */
-    struct transcode_8mhz: led::transcode {
-        constexpr transcode_8mhz(buffer &buf):
+    template<typename Encoder>
+    struct transcode_with: led::transcode {
+        using encoder = Encoder;
+
+        constexpr transcode_with(buffer &buf):
             led::transcode(buf)
         {};
 
-        constexpr static size_t bytes_per_led = 24;
+        constexpr transcode_with():
+            led::transcode()
+        {};
+
+        constexpr static size_t bytes_per_led = encoder::bytes_per_led;
+
+        constexpr static size_t bytes_per_reset = encoder::bytes_per_reset;
+
+        ret_code_t write(color::rgb &value) override
+        {
+            uint8_t buf[bytes_per_led];
+
+            encoder::encode_led(value, buf);
+
+            return output.write(buf, sizeof(buf));
+        }
+
+        void encode(color::rgb const *values, size_t n, uint8_t *out) override
+        {
+            for (size_t i = 0; i < n; ++i, out += bytes_per_led) {
+                encoder::encode_led(values[i], out);
+            }
+        }
+
+        void encode_rgbw(color::rgbw const *values, size_t n, uint8_t *out) override
+        {
+            if constexpr (encoder::channels == 4) {
+                for (size_t i = 0; i < n; ++i, out += bytes_per_led) {
+                    encoder::encode_led(values[i], out);
+                }
+            } else {
+                led::transcode::encode_rgbw(values, n, out);
+            }
+        }
 
-        constexpr static size_t bytes_per_reset = 1000;
+        led::render_loop_t render_loop(led::color_mode mode, bool corrected, bool extract_white) override
+        {
+            return led::select_render_loop<encoder>(mode, corrected, extract_white);
+        }
 
-        ret_code_t write_bus_reset() override;
+        size_t channels() override
+        {
+            return encoder::channels;
+        }
 
-        ret_code_t write(color::rgb &value) override;
+        size_t led_size() override
+        {
+            return bytes_per_led;
+        }
+
+        size_t reset_size() override
+        {
+            return bytes_per_reset;
+        }
+
+        uint8_t const *header() override
+        {
+            return encoder::header();
+        }
+
+        size_t header_size() override
+        {
+            return encoder::bytes_per_header;
+        }
     };
 
+    /**
+     * @brief Transcode LED data for `Chip` over SPI at `Frequency`.
+     *
+     * The SPI bit patterns, the size of an LED and the size of a bus reset
+     * all follow from the chip's timing, see `spi::encoding`.
+     */
+    template<typename Chip, spi_frequency Frequency, size_t SymbolBits = 0>
+    using transcode_chip = transcode_with<encoding<Chip, bit_ps(Frequency), SymbolBits>>;
+
+    /* bytes of zeros before the first LED of an APA102 frame */
+    constexpr size_t apa102_start_frame = 4;
+
+    /**
+     * @brief Bytes of zeros after the last LED of an APA102 frame.
+     * 
+     * 32 bits for the SK9822, which latches the LEDs on them, and then a
+     * clock edge for every 2 LEDs, since each LED delays the data by half
+     * a clock. Zeros instead of the ones in the APA102 datasheet work for
+     * both chips.
+     */
+    constexpr size_t apa102_end_frame(size_t n_leds)
+    {
+        return 4 + (n_leds + 15) / 16;
+    }
+
+    /**
+     * @brief Encoder for APA102 and SK9822 LEDs: 3 set bits and the 5-bit
+     *        global brightness, then blue, green and red.
+     */
+    template<uint8_t Brightness>
+    struct apa102_encoder {
+        static_assert(Brightness <= 31);
+
+        constexpr static size_t channels = 3;
+
+        constexpr static size_t bytes_per_led = 4;
+
+        /* both the start frame and the end frame, sized for the longest strip */
+        constexpr static size_t bytes_per_reset = std::max(apa102_start_frame, apa102_end_frame(LED_APA102_MAX_LEDS));
+
+        constexpr static size_t bytes_per_header = 0;
+
+        static inline uint8_t const *header()
+        {
+            return nullptr;
+        }
+
+        static inline void encode_led(color::rgb const &value, uint8_t *out)
+        {
+            out[0] = 0xe0 | Brightness;
+            out[1] = value.blue;
+            out[2] = value.green;
+            out[3] = value.red;
+        }
+    };
+
+    /**
+     * @brief Transcode LED data for APA102 or SK9822 over SPI.
+     * 
+     * These LEDs are clocked, so every color bit is one SPI bit, and the
+     * strip takes any frequency its wiring allows, up to `FREQ_32M`. The
+     * bus resets are the start and end frames. Strips longer than
+     * LED_APA102_MAX_LEDS need a longer end frame, so raise it for them.
+     * 
+     * @tparam Brightness The global brightness of every LED, 31 is full.
+     *                    Dimming with it instead of with the colors keeps
+     *                    all 8 bits of each color.
+     */
+    template<uint8_t Brightness = 31>
+    using transcode_apa102 = transcode_with<apa102_encoder<Brightness>>;
+
+    /**
+     * @brief Transcode LED data for transmission to WS2812 over 8MHZ SPI.
+     * 
+     * 8 SPI bits per WS2812 bit: T0H=375ns, T1H=625ns, 1us per bit.
+     */
+    using transcode_8mhz = transcode_chip<led::chips::ws2812, FREQ_8M, 8>;
+
     /**
      * @brief Alternate transcoder for WS2812 over 8MHZ SPI.
      * 
-     * Compared to `transcode_8mhz`, this transcoder is slower and less
-     * memory-efficient. However, this transcoder is also more accurate to the
-     * timings specified in the WS2812 datasheet.
+     * Compared to `transcode_8mhz`, this transcoder is less memory-efficient.
+     * However, it is also more accurate to the timings specified in the
+     * WS2812 datasheet: T0H=375ns, T1H=750ns, 1.25us per bit.
      * 
      * If we are having problems with data corruption on long LED strips, try
      * switching to this transcoder.
      */
-    struct transcode_8mhz_alt: led::transcode {
-        constexpr transcode_8mhz_alt(buffer &buf):
-            led::transcode(buf)
-        {};
+    using transcode_8mhz_alt = transcode_chip<led::chips::ws2812, FREQ_8M>;
+
+    /**
+     * @brief Compact transcoder for WS2812 over 2.67MHz SPI.
+     * 
+     * Each WS2812 bit is sent as 3 SPI bits instead of 8, so a frame needs
+     * 9 bytes per LED instead of 24. T0H=375ns, T1H=750ns, 1.125us per bit.
+     * The transport must be initialized with `FREQ_2M67`.
+     */
+    using transcode_2m67 = transcode_chip<led::chips::ws2812, FREQ_2M67>;
+
+    /**
+     * @brief Transcode LED data for transmission to SK6812 RGBW over 8MHZ
+     *        SPI.
+     * 
+     * 8 SPI bits per SK6812 bit: T0H=250ns, T1H=500ns, 1us per bit. LEDs
+     * take 32 bits, in the order green, red, blue, white, and renderers
+     * keep 4 bytes per LED for strips driven by this transcoder.
+     */
+    using transcode_rgbw_8mhz = transcode_chip<led::chips::sk6812_rgbw, FREQ_8M, 8>;
 
-        constexpr static size_t bytes_per_led = 30;
+    static_assert(transcode_8mhz::bytes_per_led == 24 && transcode_8mhz::bytes_per_reset == 1000);
+    static_assert(transcode_8mhz_alt::bytes_per_led == 30 && transcode_8mhz_alt::bytes_per_reset == 1000);
+    static_assert(transcode_2m67::bytes_per_led == 9 && transcode_2m67::bytes_per_reset == 334);
+    static_assert(transcode_rgbw_8mhz::bytes_per_led == 32);
+    static_assert(transcode_apa102<>::bytes_per_led == 4);
 
-        constexpr static size_t bytes_per_reset = 1000;
+    /* 32 bits, and then a bit for every 2 LEDs, for every length of strip */
+    constexpr bool apa102_end_frame_fits(size_t max_leds)
+    {
+        for (size_t n = 0; n <= max_leds; ++n) {
+            if (apa102_end_frame(n) * 8 < 32 + (n + 1) / 2 || apa102_end_frame(n) > apa102_end_frame(max_leds)) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-        ret_code_t write_bus_reset() override;
+    static_assert(apa102_end_frame(0) == 4 && apa102_end_frame(1) == 5 && apa102_end_frame(16) == 5 && apa102_end_frame(17) == 6);
+    static_assert(apa102_end_frame_fits(LED_APA102_MAX_LEDS));
+    static_assert(transcode_apa102<>::bytes_per_reset >= apa102_start_frame
+        && transcode_apa102<>::bytes_per_reset >= apa102_end_frame(LED_APA102_MAX_LEDS));
 
-        ret_code_t write(color::rgb &value) override;
-    };
+    /* whether `encoding` compiles for `Chip`, which checks its timings */
+    template<typename Chip, spi_frequency Frequency, size_t SymbolBits = 0>
+    constexpr bool encodes = encoding<Chip, bit_ps(Frequency), SymbolBits>::bytes_per_led > 0;
+
+    /* Every chip at every frequency that can drive it, whether or not a
+     * transcoder above uses it. 8 bit symbols at 8MHz are too short for the
+     * TM1814's 1 bit, and at 2.67MHz only the WS2812 has 3 bit symbols
+     * within its tolerances. */
+    static_assert(encodes<led::chips::ws2812, FREQ_8M> && encodes<led::chips::ws2812, FREQ_8M, 8>
+        && encodes<led::chips::ws2812, FREQ_16M> && encodes<led::chips::ws2812, FREQ_32M>
+        && encodes<led::chips::ws2812, FREQ_2M67>);
+    static_assert(encodes<led::chips::ws2811, FREQ_8M> && encodes<led::chips::ws2811, FREQ_8M, 8>
+        && encodes<led::chips::ws2811, FREQ_16M> && encodes<led::chips::ws2811, FREQ_32M>);
+    static_assert(encodes<led::chips::sk6812, FREQ_8M> && encodes<led::chips::sk6812, FREQ_8M, 8>
+        && encodes<led::chips::sk6812, FREQ_16M> && encodes<led::chips::sk6812, FREQ_32M>);
+    static_assert(encodes<led::chips::sk6812_rgbw, FREQ_8M> && encodes<led::chips::sk6812_rgbw, FREQ_8M, 8>
+        && encodes<led::chips::sk6812_rgbw, FREQ_16M> && encodes<led::chips::sk6812_rgbw, FREQ_32M>);
+    static_assert(encodes<led::chips::tm1814<0>, FREQ_8M>
+        && encodes<led::chips::tm1814<0>, FREQ_16M> && encodes<led::chips::tm1814<0>, FREQ_32M>);
+    static_assert(transcode_chip<led::chips::tm1814<0>, FREQ_8M>::encoder::bytes_per_header == 80);
 }
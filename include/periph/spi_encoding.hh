@@ -0,0 +1,170 @@
+#pragma once
+
+#include "prelude.hh"
+#include "color.hh"
+#include "led/chip.hh"
+#include <utility>
+
+namespace spi {
+    /**
+     * @brief Number of SPI bits in the high pulse of a symbol.
+     *
+     * The one whose high time is closest to `high_ns`, among those that
+     * leave a low time of at least `min_low_ns`. Ties go to the shorter one.
+     *
+     * @return 0 if no pulse leaves enough low time.
+     */
+    constexpr size_t symbol_high_bits(uint32_t high_ns, uint32_t min_low_ns, size_t symbol_bits, uint32_t bit_ps)
+    {
+        size_t best = 0;
+        uint64_t best_err = UINT64_MAX;
+
+        for (size_t n = 1; n < symbol_bits; ++n) {
+            uint64_t const high_ps = (uint64_t)n * bit_ps;
+            uint64_t const low_ps = (uint64_t)(symbol_bits - n) * bit_ps;
+            if (low_ps < (uint64_t)min_low_ns * 1000) {
+                continue;
+            }
+
+            auto const target_ps = (uint64_t)high_ns * 1000;
+            auto const err = high_ps > target_ps ? high_ps - target_ps : target_ps - high_ps;
+            if (err < best_err) {
+                best = n;
+                best_err = err;
+            }
+        }
+
+        return best;
+    }
+
+    /* whether `actual_ps` is within `tolerance_ns` of `nominal_ns` */
+    constexpr bool within_ns(uint64_t actual_ps, uint32_t nominal_ns, uint32_t tolerance_ns)
+    {
+        return actual_ps + (uint64_t)tolerance_ns * 1000 >= (uint64_t)nominal_ns * 1000
+            && actual_ps <= ((uint64_t)nominal_ns + tolerance_ns) * 1000;
+    }
+
+    /**
+     * @brief SPI bytes for each possible color byte, MSB first.
+     *
+     * Each of the 8 bits becomes a symbol of `SymbolBits` SPI bits, starting
+     * with `zero_high` or `one_high` set bits, so a color byte takes
+     * `SymbolBits` bytes. Symbols
+     * straddle byte boundaries unless `SymbolBits` is a multiple of 8.
+     */
+    template<size_t SymbolBits>
+    struct symbol_table {
+        constexpr symbol_table(size_t zero_high, size_t one_high):
+            bytes {}
+        {
+            for (size_t value = 0; value <= UINT8_MAX; ++value) {
+                for (size_t bit = 0; bit < 8; ++bit) {
+                    auto const high = (value & (0x80 >> bit)) ? one_high : zero_high;
+                    for (size_t i = 0; i < high; ++i) {
+                        auto const pos = bit * SymbolBits + i;
+                        bytes[value][pos / 8] |= 0x80 >> (pos % 8);
+                    }
+                }
+            }
+        }
+
+        uint8_t bytes[UINT8_MAX + 1][SymbolBits];
+    };
+
+    /**
+     * @brief Encoder for `Chip` over SPI with a bit time of `BitPs`
+     *        picoseconds, generated at compile time.
+     *
+     * @tparam SymbolBits SPI bits per chip bit. 0 picks the number that is
+     *                    closest to the chip's bit period.
+     *
+     * Fails to compile if the chip can't be driven within its datasheet
+     * tolerances at this bit time.
+     */
+    template<typename Chip, uint32_t BitPs, size_t SymbolBits = 0>
+    struct encoding {
+        constexpr static led::chip spec = Chip::spec;
+
+        constexpr static size_t symbol_bits = SymbolBits ? SymbolBits
+            : ((uint64_t)spec.period_ns * 1000 + BitPs / 2) / BitPs;
+
+        constexpr static size_t zero_high = symbol_high_bits(spec.t0h_ns, spec.min_low_ns, symbol_bits, BitPs);
+        constexpr static size_t one_high = symbol_high_bits(spec.t1h_ns, spec.min_low_ns, symbol_bits, BitPs);
+
+        constexpr static size_t channels = spec.n_channels;
+
+        /* 8 symbols of `symbol_bits` bits */
+        constexpr static size_t bytes_per_channel = symbol_bits;
+
+        constexpr static size_t bytes_per_led = spec.n_channels * bytes_per_channel;
+
+        constexpr static size_t bytes_per_reset = ((uint64_t)spec.reset_ns * 1000 + 8 * BitPs - 1) / (8 * BitPs);
+
+        /* the chip's header, encoded like the colors */
+        constexpr static size_t bytes_per_header = spec.header_size * bytes_per_channel;
+
+        static_assert(spec.n_channels >= 1 && spec.n_channels <= 4);
+        static_assert(spec.header_size <= sizeof(spec.header));
+        static_assert(zero_high > 0 && one_high > zero_high,
+            "no symbols with enough low time to tell 0 from 1");
+        static_assert(within_ns(zero_high * BitPs, spec.t0h_ns, spec.high_tolerance_ns),
+            "T0H is out of tolerance");
+        static_assert(within_ns(one_high * BitPs, spec.t1h_ns, spec.high_tolerance_ns),
+            "T1H is out of tolerance");
+        static_assert(within_ns(symbol_bits * BitPs, spec.period_ns, spec.period_tolerance_ns),
+            "bit period is out of tolerance");
+
+        /* lives in flash */
+        constexpr static symbol_table<symbol_bits> table = symbol_table<symbol_bits>(zero_high, one_high);
+
+        static inline void encode_led(color::rgb const &value, uint8_t *out)
+        {
+            encode_channels(value, out, std::make_index_sequence<spec.n_channels>());
+        }
+
+        static inline void encode_led(color::rgbw const &value, uint8_t *out)
+        {
+            encode_channels(value, out, std::make_index_sequence<spec.n_channels>());
+        }
+
+        /**
+         * @brief The encoded header, `bytes_per_header` long, or nullptr if
+         *        the chip has none.
+         *
+         * This is in RAM because EasyDMA can't read from flash, so that
+         * transports can send it as it is.
+         */
+        static inline uint8_t const *header()
+        {
+            if constexpr (bytes_per_header == 0) {
+                return nullptr;
+            } else {
+                static encoded_header encoded = encode_header();
+                return encoded.bytes;
+            }
+        }
+
+    protected:
+        struct encoded_header {
+            uint8_t bytes[bytes_per_header ? bytes_per_header : 1];
+        };
+
+        constexpr static encoded_header encode_header()
+        {
+            encoded_header result {};
+            for (size_t i = 0; i < spec.header_size; ++i) {
+                for (size_t j = 0; j < bytes_per_channel; ++j) {
+                    result.bytes[i * bytes_per_channel + j] = table.bytes[spec.header[i]][j];
+                }
+            }
+            return result;
+        }
+
+        /* unrolled, so that each channel is a fixed byte of `value` */
+        template<typename Pixel, size_t... I>
+        static inline void encode_channels(Pixel const &value, uint8_t *out, std::index_sequence<I...>)
+        {
+            (memcpy(&out[I * bytes_per_channel], table.bytes[led::channel_value(value, spec.order[I])], bytes_per_channel), ...);
+        }
+    };
+}
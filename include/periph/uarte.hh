@@ -2,6 +2,15 @@
 
 #include "dmx/transport.hh"
 #include "sdk_config.h"
+#include "nrfx_timer.h"
+
+#ifndef DMX_RX_BUFFERS
+/* DMA buffers per UARTE, of `DMX_MAX_FRAME_SIZE` bytes. One is being
+ * received into, one is queued behind it, and the others hold frames for
+ * the packet task: the latest dimmer frame, queued alternate start code
+ * frames, and the one being handled. */
+#define DMX_RX_BUFFERS 4
+#endif
 
 namespace uarte {
     using pin_t = uint32_t;
@@ -30,6 +39,10 @@ namespace uarte {
         baud_rate baud;
         pin_t rx;
         bool two_stop_bits;
+        /* Counts received bytes, so that frames end at the next break, or
+         * after `set_frame_size` bytes. Without it, frames only end when
+         * the buffer is full. */
+        nrfx_timer_t const *byte_counter;
     };
 
     struct transport: dmx::transport {
@@ -39,7 +52,11 @@ namespace uarte {
 
         ret_code_t init(uarte_init const &init);
 
-        MessageBufferHandle_t frame_buf() override;
+        ret_code_t receive(dmx::rx_frame *frame, TickType_t max_delay) override;
+
+        void release(dmx::rx_frame const &frame) override;
+
+        void set_frame_size(size_t n_bytes) override;
 
         ret_code_t enable() override;
 
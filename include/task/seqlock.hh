@@ -0,0 +1,103 @@
+#pragma once
+
+#include "prelude.hh"
+
+namespace task {
+
+/**
+ * @brief A value with one writer and any number of readers, without locks.
+ *
+ * The writer fills whichever of the two copies is not the latest one, then
+ * makes it the latest. A reader copies the latest one, and only retries if
+ * the writer has published twice during the copy and started writing over
+ * it. Readers skip the copy entirely if nothing was published since their
+ * last read.
+ *
+ * Writers must not run concurrently with each other.
+ */
+template<typename T>
+struct seqlock {
+    constexpr seqlock():
+        version(0),
+        latest(0),
+        seq {},
+        data {}
+    {}
+
+    /**
+     * @brief Start writing the next value.
+     *
+     * @return The copy to fill in. Call `publish` once it is complete.
+     */
+    T *begin_write()
+    {
+        auto const i = latest ^ 1;
+        seq[i] += 1; /* odd: being written */
+        __DMB();
+        return &data[i];
+    }
+
+    void publish()
+    {
+        auto const i = latest ^ 1;
+        __DMB();
+        seq[i] += 1; /* even: complete */
+        latest = i;
+        __DMB();
+        version += 1;
+    }
+
+    /**
+     * @brief The latest value. Only the writer may call this, since it is
+     *        the only one that knows the value won't change under it.
+     */
+    T const &peek() const
+    {
+        return data[latest];
+    }
+
+    /**
+     * @brief Call `f` with a consistent snapshot of the latest value, unless
+     *        nothing was published since `*last_version`.
+     *
+     * `f` may be called more than once, and only its last call sees a
+     * consistent value, so it should only copy.
+     *
+     * @return Whether `f` was called.
+     */
+    template<typename F>
+    bool read(uint32_t *last_version, F &&f) const
+    {
+        while (1) {
+            auto const v = version;
+            if (v == *last_version) {
+                return false;
+            }
+
+            __DMB();
+            auto const i = latest;
+            auto const s = seq[i];
+            if (s & 1) {
+                continue;
+            }
+
+            __DMB();
+            f((T const&)data[i]);
+            __DMB();
+
+            if (seq[i] == s) {
+                /* anything published after `v` is picked up by the next read */
+                *last_version = v;
+                return true;
+            }
+        }
+    }
+
+protected:
+    volatile uint32_t version;
+    volatile uint8_t latest;
+    volatile uint32_t seq[2];
+    T data[2];
+};
+
+}
@@ -23,6 +23,9 @@ namespace userapp {
 
     app_state get_app_state();
 
+    /* the default app only depends on its DMX values and LED config */
+    bool is_default_app();
+
     storage_state get_storage_state();
 
     ret_code_t erase();
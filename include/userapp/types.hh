@@ -36,16 +36,27 @@ packed_struct led_chan {
     uint16_t n_leds;
     uint16_t dmx_vals_len;
     uint8_t dmx_personality_idx;
+    /* LEDs changed by `refresh`. Set to every LED before `refresh` is
+     * called, apps may narrow it down. */
+    uint16_t dirty_first;
+    uint16_t dirty_count;
+    /* bytes per LED in `buffer`: 3 (red, green, blue), or 4 (white last)
+     * for strips with a white channel. Apps that ignore it only work on
+     * strips without one. */
+    uint8_t channels;
 
     constexpr led_chan(led::renderer_props const &props):
         buffer(nullptr),
         dmx_vals(props.dmx_vals),
         id(0),
         color_mode(props.render_config.color_mode),
-        refresh_rate(props.render_config.refresh_msec),
+        refresh_rate(props.refresh_msec),
         n_leds(props.render_config.n_leds),
         dmx_vals_len(props.dmx_config.n_channels),
-        dmx_personality_idx(props.dmx_config.personality)
+        dmx_personality_idx(props.dmx_config.personality),
+        dirty_first(0),
+        dirty_count(props.render_config.n_leds),
+        channels(3)
     {}
 };
 
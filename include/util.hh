@@ -79,6 +79,10 @@ struct buffer {
 
     ret_code_t fill(uint8_t value, size_t n);
 
+    /* Claim the next `nbytes` of the buffer, to be written through the
+     * returned pointer. Returns nullptr if there isn't enough room. */
+    uint8_t *reserve(size_t nbytes);
+
 protected:
     uint8_t *basep;
     size_t pos;
@@ -158,7 +158,7 @@ static void dmx_char_write_handler(void *arg)
         xQueueReceive(m_dmx_char_write_queue, &evt, portMAX_DELAY);
 
         if (evt.kind == char_write::VALUE) {
-            auto vals = dmx_slot_vals { evt.n_values, evt.value };
+            auto vals = dmx_slot_vals { evt.n_values, evt.value, nullptr };
             m_dmx_thread->send(&vals);
         }
 
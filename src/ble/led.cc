@@ -19,9 +19,14 @@
 #error MAX_LED_CHANNELS cannot be less than 1
 #endif
 
+#ifndef RENDER_BATCH_SIZE
+/* number of HSV/HSL pixels converted on the stack before being encoded */
+#define RENDER_BATCH_SIZE 16
+#endif
+
 using namespace led;
 
-enum class handle_write_type: uint8_t { color_mode, num_leds, refresh_rate };
+enum class handle_write_type: uint8_t { color_mode, num_leds, refresh_rate, max_frame_rate, color_correction };
 
 struct service_context;
 
@@ -32,6 +37,7 @@ packed_struct handle_write_data {
         uint8_t color_mode;
         uint16_t num_leds;
         uint16_t refresh_rate;
+        cfg::led_color_t color;
     };
     handle_write_type type;
     bool save;
@@ -41,23 +47,79 @@ static TaskHandle_t m_handle_led_prop_write_thread;
 static QueueHandle_t m_handle_led_prop_write_queue;
 
 struct service_context {
-    constexpr service_context(cfg::param<cfg::led_render_t> param):
+    constexpr service_context(cfg::param<cfg::led_render_t> param, cfg::param<cfg::led_color_t> color_param):
         buf_num_leds { MAX_LEDS_PER_THREAD % (UINT8_MAX+1), MAX_LEDS_PER_THREAD / (UINT8_MAX+1) },
         buf_color_mode { (uint8_t)led::color_mode::rgb },
         buf_refresh_rate { DEFAULT_REFRESH_RATE_MSEC % (UINT8_MAX+1), DEFAULT_REFRESH_RATE_MSEC / (UINT8_MAX+1) },
+        buf_max_frame_rate {},
+        buf_color_correction { 10, 255, 255, 255, 255, 0 },
         config_param(param),
+        color_param(color_param),
         reset_strip(true),
         seqwrite_offset(0),
-        user_buffer {}
+        user_buffer(nullptr),
+        capacity(0),
+        channels(sizeof(color::rgb)),
+        dirty {},
+        history {},
+        last_color_mode(0),
+        last_n_leds(0),
+        stats {},
+        owner(nullptr),
+        color { 10, { 255, 255, 255 }, 255, 0 },
+        lut {},
+        lut_dirty(false),
+        lut_active(false),
+        extract_white(false)
     {}
 
     uint8_t buf_num_leds[sizeof(uint16_t)];
     uint8_t buf_color_mode[sizeof(uint8_t)];
     uint8_t buf_refresh_rate[sizeof(uint16_t)];
+    uint8_t buf_max_frame_rate[sizeof(uint16_t)];
+    uint8_t buf_color_correction[sizeof(cfg::led_color_t)];
     cfg::param<cfg::led_render_t> config_param;
+    cfg::param<cfg::led_color_t> color_param;
     bool reset_strip;
     size_t seqwrite_offset;
-    uint8_t user_buffer[MAX_LEDS_PER_THREAD * 3];
+    uint8_t *user_buffer;           /* in the LED arena, see `svc::set_arena` */
+    size_t capacity;                /* LEDs in `user_buffer` */
+    size_t channels;                /* bytes per LED in `user_buffer`, 4 for strips with a white channel */
+    led::dirty_range dirty;         /* changed since the last frame */
+    led::dirty_history<4, led::n_frame_buffers> history; /* what each frame buffer is missing */
+    uint8_t last_color_mode;
+    size_t last_n_leds;
+    led::render_stats stats;
+    led::thread *owner;             /* the LED thread that renders this channel */
+    cfg::led_color_t color;         /* the saved color correction */
+    color::correction lut;          /* built from `color` by the renderer */
+    volatile bool lut_dirty;        /* `color` changed since `lut` was built */
+    bool lut_active;                /* false if `lut` would change nothing */
+    bool extract_white;             /* from `color`, only used by strips with a white channel */
+
+    /* the most LEDs the channel can have, see `led::thread::max_leds` */
+    size_t max_leds()
+    {
+        return owner ? owner->max_leds() : MAX_LEDS_PER_THREAD;
+    }
+
+    /* new input from a BLE write, see `led::renderer::commit` */
+    void commit()
+    {
+        if (owner) {
+            owner->trigger();
+        }
+    }
+
+    led::dirty_range take_dirty()
+    {
+        led::dirty_range result;
+        CRITICAL_REGION_ENTER();
+            result = dirty;
+            dirty.clear();
+        CRITICAL_REGION_EXIT();
+        return result;
+    }
 
     void reject_write_color_mode(ble::characteristic *characteristic)
     {
@@ -147,6 +209,63 @@ struct service_context {
             xQueueSend(m_handle_led_prop_write_queue, &data, 1);
     }
 
+    void reject_write_color_correction(ble::characteristic *characteristic)
+    {
+        auto data = handle_write_data {
+            .serv_context = this,
+            .characteristic = characteristic,
+            .type = handle_write_type::color_correction,
+            .save = false,
+        };
+        if (task::is_in_isr())
+            xQueueSendFromISR(m_handle_led_prop_write_queue, &data, nullptr);
+        else
+            xQueueSend(m_handle_led_prop_write_queue, &data, 1);
+    }
+
+    void accept_write_color_correction(cfg::led_color_t const &value, ble::characteristic *characteristic)
+    {
+        auto data = handle_write_data {
+            .serv_context = this,
+            .characteristic = characteristic,
+            .color = value,
+            .type = handle_write_type::color_correction,
+            .save = true
+        };
+        if (task::is_in_isr())
+            xQueueSendFromISR(m_handle_led_prop_write_queue, &data, nullptr);
+        else
+            xQueueSend(m_handle_led_prop_write_queue, &data, 1);
+    }
+
+    /* called from the cfg subscription, the renderer rebuilds the table before its next frame */
+    void set_color(cfg::led_color_t const &value)
+    {
+        CRITICAL_REGION_ENTER();
+            color = value;
+            lut_dirty = true;
+        CRITICAL_REGION_EXIT();
+        commit();
+    }
+
+    /* called by the LED thread, so the value is only notified, never saved */
+    void update_max_frame_rate(uint16_t value, ble::characteristic *characteristic)
+    {
+        if (uint16_decode(buf_max_frame_rate) == value) {
+            return;
+        }
+
+        uint16_encode(value, buf_max_frame_rate);
+
+        auto data = handle_write_data {
+            .serv_context = this,
+            .characteristic = characteristic,
+            .type = handle_write_type::max_frame_rate,
+            .save = false
+        };
+        xQueueSend(m_handle_led_prop_write_queue, &data, 0);
+    }
+
 };
 
 static void handle_led_prop_write(void *context)
@@ -166,6 +285,21 @@ static void handle_led_prop_write(void *context)
         case handle_write_type::refresh_rate: {
             req.characteristic->send(req.serv_context->buf_refresh_rate, sizeof(req.serv_context->buf_refresh_rate));
         }   break;
+        case handle_write_type::max_frame_rate: {
+            req.characteristic->send(req.serv_context->buf_max_frame_rate, sizeof(req.serv_context->buf_max_frame_rate));
+        }   break;
+        case handle_write_type::color_correction: {
+            req.characteristic->send(req.serv_context->buf_color_correction, sizeof(req.serv_context->buf_color_correction));
+        }   break;
+        }
+
+        /* color correction has a param of its own */
+        if (req.save && req.type == handle_write_type::color_correction) {
+            ret = req.serv_context->color_param.set(&req.color);
+            if (ret != NRF_SUCCESS) {
+                NRF_LOG_WARNING("Failed to update color correction: %u", ret);
+            }
+            continue;
         }
 
         if (req.save) {
@@ -186,6 +320,9 @@ static void handle_led_prop_write(void *context)
             case handle_write_type::refresh_rate: {
                 config.refresh_msec = req.refresh_rate;
             }   break;
+            case handle_write_type::max_frame_rate:
+            case handle_write_type::color_correction:
+                break;
             }
 
             ret = req.serv_context->config_param.set(&config);
@@ -229,6 +366,86 @@ static ret_code_t init_handle_led_prop_write()
     return NRF_SUCCESS;
 }
 
+/* Convert `n` pixels from `mode` to RGB, correct them with `lut` unless it is
+ * nullptr, and encode them into `out`, which was reserved from `transcoder`.
+ * Pixels have `transcoder->channels()` bytes each, the fourth one being
+ * white. If `pixels` is nullptr, the LEDs are off. */
+static void render_pixels(led::transcode *transcoder, uint8_t *out, uint8_t const *pixels, size_t n, led::color_mode mode, color::correction const *lut, bool extract_white)
+{
+    static const color::rgb black[RENDER_BATCH_SIZE] = {};
+    color::rgb batch[RENDER_BATCH_SIZE];
+    color::rgbw batch_rgbw[RENDER_BATCH_SIZE];
+
+    auto const led_size = transcoder->led_size();
+    auto const channels = transcoder->channels();
+
+    /* Picked once per frame, the loop itself has no mode switch or virtual
+     * calls. Black is black after any correction. */
+    auto const loop = pixels
+        ? transcoder->render_loop(mode, lut != nullptr, extract_white)
+        : transcoder->render_loop(color_mode::rgb, false, false);
+
+    if (loop && !pixels) {
+        /* led::zeros doubles as a black frame */
+        for (size_t i = 0; i < n; i += sizeof(zeros) / channels) {
+            auto const count = std::min<size_t>(n - i, sizeof(zeros) / channels);
+            loop(&out[i * led_size], zeros, count, nullptr);
+        }
+        return;
+    } else if (loop) {
+        loop(out, pixels, n, lut);
+        return;
+    }
+
+    if (!pixels) {
+        for (size_t i = 0; i < n; i += RENDER_BATCH_SIZE) {
+            auto const count = std::min<size_t>(n - i, RENDER_BATCH_SIZE);
+            transcoder->encode(black, count, &out[i * led_size]);
+        }
+        return;
+    }
+
+    if (mode != color_mode::hsv && mode != color_mode::hsl && !lut && channels == 3) {
+        /* user buffers have the same layout as color::rgb */
+        static_assert(sizeof(color::rgb) == 3);
+        transcoder->encode((color::rgb const*)pixels, n, out);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i += RENDER_BATCH_SIZE) {
+        auto const count = std::min<size_t>(n - i, RENDER_BATCH_SIZE);
+        auto p = &pixels[channels * i];
+
+        for (size_t j = 0; j < count; ++j, p += channels) {
+            if (mode == color_mode::hsv) {
+                color::hsv(p[0], p[1], p[2]).to_rgb(batch[j], color::curve::ws2812);
+            } else if (mode == color_mode::hsl) {
+                color::hsl(p[0], p[1], p[2]).to_rgb(batch[j], color::curve::ws2812);
+            } else {
+                batch[j] = color::rgb(p[0], p[1], p[2]);
+            }
+
+            if (channels == 4) {
+                batch_rgbw[j] = color::rgbw(batch[j], p[3]);
+                if (extract_white) {
+                    color::extract_white(batch_rgbw[j]);
+                }
+                if (lut) {
+                    lut->apply(batch_rgbw[j]);
+                }
+            } else if (lut) {
+                lut->apply(batch[j]);
+            }
+        }
+
+        if (channels == 4) {
+            transcoder->encode_rgbw(batch_rgbw, count, &out[i * led_size]);
+        } else {
+            transcoder->encode(batch, count, &out[i * led_size]);
+        }
+    }
+}
+
 static uint16_t m_service_handles[MAX_LED_CHANNELS] = {
     BLE_GATT_HANDLE_INVALID,
 #if MAX_LED_CHANNELS >= 2
@@ -243,15 +460,15 @@ static uint16_t m_service_handles[MAX_LED_CHANNELS] = {
 };
 
 static service_context m_context[MAX_LED_CHANNELS] = {
-    service_context(cfg::led0::render),
+    service_context(cfg::led0::render, cfg::led0::color),
 #if MAX_LED_CHANNELS >= 2
-    service_context(cfg::led1::render),
+    service_context(cfg::led1::render, cfg::led1::color),
 #endif
 #if MAX_LED_CHANNELS >= 3
-    service_context(cfg::led2::render),
+    service_context(cfg::led2::render, cfg::led2::color),
 #endif
 #if MAX_LED_CHANNELS >= 4
-    service_context(cfg::led3::render),
+    service_context(cfg::led3::render, cfg::led3::color),
 #endif
 };
 
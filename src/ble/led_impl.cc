@@ -12,10 +12,30 @@ struct service_context {
     uint8_t buf_num_leds[2];
     uint8_t buf_color_mode[1];
     uint8_t buf_refresh_rate[2];
+    uint8_t buf_max_frame_rate[2];
+    uint8_t buf_color_correction[6];
     cfg::param<cfg::led_render_t> config_param;
+    cfg::param<cfg::led_color_t> color_param;
     bool reset_strip;
     size_t seqwrite_offset;
-    uint8_t user_buffer[MAX_LEDS_PER_THREAD * 3];
+    uint8_t *user_buffer;
+    size_t capacity;
+    size_t channels;
+    led::dirty_range dirty;
+    led::dirty_history<4, led::n_frame_buffers> history;
+    uint8_t last_color_mode;
+    size_t last_n_leds;
+    led::render_stats stats;
+    led::thread *owner;
+    cfg::led_color_t color;
+    color::correction lut;
+    bool lut_dirty;
+    bool lut_active;
+    bool extract_white;
+
+    size_t max_leds();
+    void commit();
+    led::dirty_range take_dirty();
 
     void reject_write_color_mode(ble::characteristic *characteristic);
     void reject_write_refresh_rate(ble::characteristic *characteristic);
@@ -23,22 +43,27 @@ struct service_context {
     void accept_write_color_mode(uint8_t value, ble::characteristic *characteristic);
     void accept_write_refresh_rate(uint16_t value, ble::characteristic *characteristic);
     void accept_write_num_leds(uint16_t value, ble::characteristic *characteristic);
+    void update_max_frame_rate(uint16_t value, ble::characteristic *characteristic);
+    void reject_write_color_correction(ble::characteristic *characteristic);
+    void accept_write_color_correction(cfg::led_color_t const &value, ble::characteristic *characteristic);
+    void set_color(cfg::led_color_t const &value);
 };
 extern uint16_t m_service_handles[MAX_LED_CHANNELS] = {};
 extern service_context m_context[MAX_LED_CHANNELS] = {};
 extern xSemaphoreHandle m_dmx_lock[MAX_LED_CHANNELS] = {};
 extern bool handle_led_prop_write_is_initialized();
 extern ret_code_t init_handle_led_prop_write();
+extern void render_pixels(led::transcode *transcoder, uint8_t *out, uint8_t const *pixels, size_t n, led::color_mode mode, color::correction const *lut, bool extract_white);
 using namespace led;
 #endif /* VSCODE */
 
-#define SHIFT(p) *p; ++p
-
 #define svc concat(service_,CHN)
 #define cfgx cfg::concat(led,CHN)
 #define m_num_leds concat(m_num_leds_,CHN)
 #define m_color_mode concat(m_color_mode_,CHN)
 #define m_refresh_rate concat(m_refresh_rate_,CHN)
+#define m_max_frame_rate concat(m_max_frame_rate_,CHN)
+#define m_color_correction concat(m_color_correction_,CHN)
 #define m_control concat(m_control_,CHN)
 #define context (m_context[CHN])
 #define SCHN stringify(CHN)
@@ -46,6 +71,8 @@ using namespace led;
 static svc::num_leds_char m_num_leds;
 static svc::color_mode_char m_color_mode;
 static svc::refresh_rate_char m_refresh_rate;
+static svc::max_frame_rate_char m_max_frame_rate;
+static svc::color_correction_char m_color_correction;
 static svc::control_char m_control;
 
 #define on_num_leds_write concat(on_num_leds_write_,CHN)
@@ -60,6 +87,10 @@ BLE_GATT_WRITE_OBSERVER(concat(m_color_mode,_write), m_color_mode, on_color_mode
 static void on_refresh_rate_write(ble_gatts_evt_write_t const &event);
 BLE_GATT_WRITE_OBSERVER(concat(m_refresh_rate,_write), m_refresh_rate, on_refresh_rate_write);
 
+#define on_color_correction_write concat(on_color_correction_write_,CHN)
+static void on_color_correction_write(ble_gatts_evt_write_t const &event);
+BLE_GATT_WRITE_OBSERVER(concat(m_color_correction,_write), m_color_correction, on_color_correction_write);
+
 #define on_control_write concat(on_control_write_,CHN)
 static void on_control_write(ble_gatts_evt_write_t const &event);
 BLE_GATT_WRITE_OBSERVER(concat(m_control,_write), m_control, on_control_write);
@@ -100,6 +131,24 @@ CHARACTERISTIC_DEF(led::svc, refresh_rate_char,
     sizeof(context.buf_refresh_rate))
 {}
 
+CHARACTERISTIC_DEF(led::svc, max_frame_rate_char,
+    stringify(CHN) ": Max Frame Rate",
+    ble::char_uuid::concat3(led,CHN,_max_frame_rate),
+    ble_gatt_char_props_t { .read = true, .notify = true },
+    context.buf_max_frame_rate,
+    sizeof(context.buf_max_frame_rate),
+    sizeof(context.buf_max_frame_rate))
+{}
+
+CHARACTERISTIC_DEF(led::svc, color_correction_char,
+    stringify(CHN) ": Color Correction",
+    ble::char_uuid::concat3(led,CHN,_color_correction),
+    ble_gatt_char_props_t { .read = true, .write = true, .notify = true },
+    context.buf_color_correction,
+    sizeof(context.buf_color_correction),
+    sizeof(context.buf_color_correction))
+{}
+
 CHARACTERISTIC_DEF(led::svc, control_char,
     stringify(CHN) ": Control",
     ble::char_uuid::concat3(led,CHN,_control),
@@ -141,6 +190,16 @@ ret_code_t svc::init()
         ret = add_characteristic(m_refresh_rate);
         VERIFY_SUCCESS(ret);
 
+        m_max_frame_rate = svc::max_frame_rate_char();
+        pf.format = BLE_GATT_CPF_FORMAT_UINT16;
+        m_max_frame_rate.set_presentation_format(&pf);
+        ret = add_characteristic(m_max_frame_rate);
+        VERIFY_SUCCESS(ret);
+
+        m_color_correction = svc::color_correction_char();
+        ret = add_characteristic(m_color_correction);
+        VERIFY_SUCCESS(ret);
+
         m_control = svc::control_char();
         ret = add_characteristic(m_control);
         VERIFY_SUCCESS(ret);
@@ -150,6 +209,7 @@ ret_code_t svc::init()
         VERIFY_SUCCESS(ret);
 
         context.config_param = cfgx::render;
+        context.color_param = cfgx::color;
     }
 
     return ret;
@@ -169,17 +229,49 @@ ret_code_t svc::render(led::transcode *transcoder, led::renderer_props const &pr
 {
     ret_code_t ret;
     bool do_fill_zeros = false;
+    auto dirty = context.take_dirty();
+
+    context.update_max_frame_rate(props.max_frame_rate, &m_max_frame_rate);
+
+    /* the table is only rebuilt when the color correction changes */
+    if (context.lut_dirty) {
+        cfg::led_color_t color;
+        CRITICAL_REGION_ENTER();
+            color = context.color;
+            context.lut_dirty = false;
+        CRITICAL_REGION_EXIT();
+
+        context.lut_active = !color::correction::is_identity(color.gamma, color.gains, color.brightness);
+        if (context.lut_active) {
+            context.lut.build(color.gamma, color.gains, color.brightness);
+        }
+        context.extract_white = color.white != 0;
+        dirty.mark_all();
+    }
+    auto const lut = context.lut_active ? &context.lut : nullptr;
     
-    ret = transcoder->write_bus_reset();
+    ret = transcoder->write_frame_start();
     VERIFY_SUCCESS(ret);
 
+    /* the arena may have had less room than the channel asked for */
+    auto const n_leds = std::min({ (size_t)props.render_config.n_leds, context.capacity, transcoder->max_leds() });
+
+    /* pixels are laid out for the strip that this channel's frames are encoded for */
+    assert(context.channels == transcoder->channels() || context.capacity == 0);
+
     auto chan = led_chan(props);
     chan.buffer = context.user_buffer;
     chan.id = CHN;
+    chan.channels = context.channels;
+    chan.n_leds = n_leds;
+    chan.dirty_count = n_leds;
+
+    auto const refresh_start = pipeline_probe::cycles();
 
     if (context.reset_strip) {
         context.reset_strip = false;
         do_fill_zeros = true;
+        dirty.mark_all();
 
         ret = userapp::with(&chan, [] (userapp::init_func_t init, userapp::refresh_func_t refresh, void *ctxt) -> ret_code_t {
             unused(refresh);
@@ -198,7 +290,7 @@ ret_code_t svc::render(led::transcode *transcoder, led::renderer_props const &pr
         VERIFY_SUCCESS(ret);
 
 
-    } else if (props.render_config.n_leds > 0) {
+    } else if (n_leds > 0) {
 
         ret = userapp::with(&chan, [] (userapp::init_func_t init, userapp::refresh_func_t refresh, void *ctxt) -> ret_code_t {
             unused(refresh);
@@ -212,50 +304,46 @@ ret_code_t svc::render(led::transcode *transcoder, led::renderer_props const &pr
             context.accept_write_color_mode(chan.color_mode, &m_color_mode);
         }
 
-        if (ret == ERROR_USERCODE_NOT_AVAILABLE)
+        if (ret == ERROR_USERCODE_NOT_AVAILABLE) {
             ret = NRF_SUCCESS; // ignore 'user code unavailable' error
+        } else {
+            dirty.mark(chan.dirty_first, chan.dirty_first + chan.dirty_count);
+        }
         VERIFY_SUCCESS(ret);
     }
 
-    uint8_t *ptr = context.user_buffer;
-
-    for (size_t i = 0; i < props.render_config.n_leds && i < MAX_LEDS_PER_THREAD; ++i) {
-        color::rgb wval;
-
-        switch ((color_mode)props.render_config.color_mode) {
-        case color_mode::rgb:
-            wval.red = SHIFT(ptr);
-            wval.green = SHIFT(ptr);
-            wval.blue = SHIFT(ptr);
-            break;
-        case color_mode::hsv: {
-            color::hsv hsv;
-            hsv.hue = SHIFT(ptr);
-            hsv.saturation = SHIFT(ptr);
-            hsv.value = SHIFT(ptr);
-            hsv.to_rgb(wval, color::curve::ws2812);
-        }   break;
-        case color_mode::hsl: {
-            color::hsl hsl;
-            hsl.hue = SHIFT(ptr);
-            hsl.saturation = SHIFT(ptr);
-            hsl.luminance = SHIFT(ptr);
-            hsl.to_rgb(wval, color::curve::ws2812);
-        }   break;
-        }
+    context.stats.refresh_cycles = pipeline_probe::cycles() - refresh_start;
 
-        ret = transcoder->write(wval);
-        VERIFY_SUCCESS(ret);
+    auto const mode = (color_mode)props.render_config.color_mode;
+    auto const n_frame = do_fill_zeros ? std::min(std::max<size_t>(n_leds, MAX_LEDS_PER_THREAD), transcoder->max_leds()) : n_leds;
+
+    if (props.render_config.color_mode != context.last_color_mode || n_leds != context.last_n_leds) {
+        context.last_color_mode = props.render_config.color_mode;
+        context.last_n_leds = n_leds;
+        dirty.mark_all();
     }
 
-    if (do_fill_zeros) {
-        auto off = color::rgb(color::BLACK);
-        for (size_t i = props.render_config.n_leds; i < MAX_LEDS_PER_THREAD; ++i) {
-            ret = transcoder->write(off);
-            VERIFY_SUCCESS(ret);
-        }
+    /* one bounds check for the whole frame */
+    auto out = transcoder->reserve(n_frame);
+    if (!out) {
+        return NRF_ERROR_INVALID_LENGTH;
     }
 
+    /* the buffer is missing the changes of every frame since it was last rendered */
+    auto const span = context.history.update(transcoder, dirty).clip(n_leds);
+
+    auto const led_size = transcoder->led_size();
+    auto const transcode_start = pipeline_probe::cycles();
+
+    render_pixels(transcoder, &out[span.first * led_size], &context.user_buffer[context.channels * span.first], span.len(), mode, lut, context.extract_white);
+    render_pixels(transcoder, &out[n_leds * led_size], nullptr, n_frame - n_leds, mode, nullptr, false);
+
+    context.stats.transcode_cycles = pipeline_probe::cycles() - transcode_start;
+
+    context.stats.frames += 1;
+    context.stats.pixels_encoded = span.len() + (n_frame - n_leds);
+    context.stats.total_pixels_encoded += context.stats.pixels_encoded;
+
     ret = transcoder->write_bus_reset();
     VERIFY_SUCCESS(ret);
 
@@ -264,10 +352,69 @@ ret_code_t svc::render(led::transcode *transcoder, led::renderer_props const &pr
 
 ret_code_t svc::init_render(led::renderer_props const &props)
 {
+    context.owner = owner;
     context.buf_color_mode[0] = props.render_config.color_mode;
     uint16_encode(props.render_config.n_leds, context.buf_num_leds);
     uint16_encode(props.render_config.refresh_msec, context.buf_refresh_rate);
-    return NRF_SUCCESS;
+    uint16_encode(props.max_frame_rate, context.buf_max_frame_rate);
+
+    /* retrieve the color correction, or set up a neutral one if it is unavailable */
+    ret_code_t ret;
+    cfg::led_color_t color;
+    ret = context.color_param.get(&color);
+    if (ret == FDS_ERR_NOT_FOUND || ret == ERROR_WRONG_VERSION) {
+        color = cfg::led_color_t { .gamma = 10, .gains = { 255, 255, 255 }, .brightness = 255, .white = 0 };
+        ret = context.color_param.set(&color);
+    }
+    VERIFY_SUCCESS(ret);
+
+    memcpy(context.buf_color_correction, &color, sizeof(context.buf_color_correction));
+    context.set_color(color);
+
+    return context.color_param.subscribe(nullptr, [](void *ctxt, void const *data, size_t size) {
+        unused(ctxt);
+        assert(size >= sizeof(cfg::led_color_t));
+        context.set_color(*(cfg::led_color_t const*)data);
+    });
+}
+
+led::render_stats svc::stats()
+{
+    return context.stats;
+}
+
+bool svc::is_idle()
+{
+    bool is_caught_up;
+
+    CRITICAL_REGION_ENTER();
+        is_caught_up = context.dirty.is_empty();
+    CRITICAL_REGION_EXIT();
+
+    if (context.reset_strip || context.lut_dirty || !is_caught_up || !context.history.is_clean()) {
+        return false;
+    }
+
+    /* other apps may animate on their own, so they are refreshed every frame */
+    return userapp::get_app_state() != userapp::app_state::user_app_loaded || userapp::is_default_app();
+}
+
+size_t svc::arena_bytes_per_led(size_t channels)
+{
+    /* one byte per color channel of the strip */
+    return channels;
+}
+
+void svc::set_arena(uint8_t *pixels, size_t n_leds, size_t channels)
+{
+    context.user_buffer = pixels;
+    context.capacity = n_leds;
+    context.channels = channels;
+    context.seqwrite_offset = std::min(context.seqwrite_offset, n_leds);
+
+    /* the frame buffers may have moved too */
+    context.history = led::dirty_history<4, led::n_frame_buffers>();
+    context.dirty.mark(0, n_leds);
 }
 
 void svc::reset()
@@ -293,9 +440,9 @@ static void on_num_leds_write(ble_gatts_evt_write_t const &event)
 
     auto num_leds = uint16_decode(event.data);
 
-    if (num_leds > MAX_LEDS_PER_THREAD) {
+    if (num_leds > context.max_leds()) {
         meta::service()
-            .print("Invalid number of LEDs (maximum: " stringify(MAX_LEDS_PER_THREAD) ")");
+            .print("Invalid number of LEDs (not enough room left in the LED arena)");
         context.reject_write_num_leds(&m_num_leds);
         m_num_leds.send(notif);
     } else {
@@ -348,9 +495,10 @@ static void on_refresh_rate_write(ble_gatts_evt_write_t const &event)
 
     auto refresh_msec = uint16_decode(event.data);
 
-    if (refresh_msec < MINIMUM_REFRESH_RATE_MSEC) {
+    /* LED_REFRESH_AUTO follows the 'Max Frame Rate' characteristic */
+    if (refresh_msec != LED_REFRESH_AUTO && refresh_msec < MINIMUM_REFRESH_RATE_MSEC) {
         meta::service()
-            .print("Invalid refresh interval (minimum: " stringify(MINIMUM_REFRESH_RATE_MSEC) ")");
+            .print("Invalid refresh interval (minimum: " stringify(MINIMUM_REFRESH_RATE_MSEC) ", or 0 for as fast as possible)");
         context.reject_write_refresh_rate(&m_refresh_rate);
         m_refresh_rate.send(notif);
     } else if (refresh_msec > MAXIMUM_REFRESH_RATE_MSEC) {
@@ -363,39 +511,96 @@ static void on_refresh_rate_write(ble_gatts_evt_write_t const &event)
     }
 }
 
+/*
+    yy rr gg bb ll ww           -> gamma in tenths (10 to 30), red/green/blue gains, brightness,
+                                   white extraction (0 or 1, only used by strips with a white channel)
+*/
+static void on_color_correction_write(ble_gatts_evt_write_t const &event)
+{
+    auto notif = ble::notification {
+        .conn_handle = ble::conn_handle(),
+        .data = context.buf_color_correction,
+        .length = sizeof(context.buf_color_correction),
+        .offset = 0
+    };
+
+    if (event.len != sizeof(cfg::led_color_t) || !event.data) {
+        meta::service()
+            .print("Malformed write to Channel " SCHN " 'Color Correction' characteristic (invalid length)");
+        context.reject_write_color_correction(&m_color_correction);
+        m_color_correction.send(notif);
+        return;
+    }
+
+    auto color = cfg::led_color_t {};
+    memcpy(&color, event.data, sizeof(color));
+
+    if (color.gamma < 10 || color.gamma > 30) {
+        meta::service()
+            .print("Invalid gamma (must be 10 to 30, in tenths)");
+        memcpy(context.buf_color_correction, &context.color, sizeof(context.buf_color_correction));
+        context.reject_write_color_correction(&m_color_correction);
+        m_color_correction.send(notif);
+    } else if (color.white > 1) {
+        meta::service()
+            .print("Invalid white extraction (must be 0 or 1)");
+        memcpy(context.buf_color_correction, &context.color, sizeof(context.buf_color_correction));
+        context.reject_write_color_correction(&m_color_correction);
+        m_color_correction.send(notif);
+    } else {
+        context.accept_write_color_correction(color, &m_color_correction);
+    }
+}
+
 /*
     00                          -> turn off whole strip
-    01 xxxx yyyy aa bb cc       -> set yyyy leds starting from xxxx to (aa, bb, cc)
+    01 xxxx yyyy aa bb cc [dd]  -> set yyyy leds starting from xxxx to (aa, bb, cc), and white to dd
+                                   (0 if left out) on strips with a white channel
 
     10 xxxx                     -> set offset for "sequential write" cmd
-    11 aa bb cc ...             -> sequential write. set LEDS starting from current "sequential write" ptr
+    11 aa bb cc [dd] ...        -> sequential write. set LEDS starting from current "sequential write" ptr,
+                                   with 4 bytes per LED on strips with a white channel
 */
 static void on_control_write(ble_gatts_evt_write_t const &event)
 {
+    /* pixels are only written with interrupts off, so they can't move to
+     * another part of the LED arena during the write */
     if (event.len == 1 && event.data && event.data[0] == 0) {
-        memset(context.user_buffer, 0, sizeof(context.user_buffer));
+        CRITICAL_REGION_ENTER();
+            memset(context.user_buffer, 0, context.channels * context.capacity);
+            context.dirty.mark(0, context.capacity);
+        CRITICAL_REGION_EXIT();
         context.reset_strip = true;
+        context.commit();
 
-    } else if (event.len == 8 && event.data && event.data[0] == 1) {
-        auto offset = 3 * (size_t)uint16_decode(&event.data[1]);
+    } else if ((event.len == 8 || event.len == 9) && event.data && event.data[0] == 1) {
+        auto first = (size_t)uint16_decode(&event.data[1]);
         auto length = uint16_decode(&event.data[3]);
+        uint8_t const value[4] = { event.data[5], event.data[6], event.data[7], (uint8_t)(event.len == 9 ? event.data[8] : 0) };
 
-        for (; (offset+2 < sizeof(context.user_buffer)) && (length > 0); --length) {
-            context.user_buffer[offset++] = event.data[5];
-            context.user_buffer[offset++] = event.data[6];
-            context.user_buffer[offset++] = event.data[7];
-        }
+        CRITICAL_REGION_ENTER();
+            context.dirty.mark(first, first + length);
+
+            for (auto i = first; (i < context.capacity) && (length > 0); ++i, --length) {
+                memcpy(&context.user_buffer[context.channels * i], value, context.channels);
+            }
+        CRITICAL_REGION_EXIT();
+        context.commit();
 
     } else if (event.len == 3 && event.data && event.data[0] == 0x10) {
         context.seqwrite_offset = uint16_decode(&event.data[1]);
 
     } else if (event.len > 1 && event.data && event.data[0] == 0x11) {
         size_t i = 1;
-        for (; (i + 2 < event.len) && (context.seqwrite_offset < MAX_LEDS_PER_THREAD); ++context.seqwrite_offset) {
-            auto pos = 3 * context.seqwrite_offset;
-            context.user_buffer[pos] = event.data[i++];
-            context.user_buffer[pos+1] = event.data[i++];
-            context.user_buffer[pos+2] = event.data[i++];
-        }
+
+        CRITICAL_REGION_ENTER();
+            auto const first = context.seqwrite_offset;
+            for (; (i + context.channels <= event.len) && (context.seqwrite_offset < context.capacity); ++context.seqwrite_offset) {
+                memcpy(&context.user_buffer[context.channels * context.seqwrite_offset], &event.data[i], context.channels);
+                i += context.channels;
+            }
+            context.dirty.mark(first, context.seqwrite_offset);
+        CRITICAL_REGION_EXIT();
+        context.commit();
     }
 }
@@ -5,6 +5,7 @@
 #include "nrf_log_ctrl.h"
 #include "task.h"
 #include "util.hh"
+#include "led/pipeline.hh"
 
 // #define M_DEVICE_UID_SIZE sizeof(meta::device_uid())
 #define M_DEVICE_UID_SIZE 6 // conforms with RDM device UID size
@@ -13,6 +14,9 @@
 static meta::service::device_uid_char m_device_uid;
 static meta::service::system_control_char m_sys_control;
 static meta::service::log_char m_log;
+#if LED_PIPELINE_STATS
+static meta::service::pipeline_char m_pipeline;
+#endif
 
 static uint16_t m_service_handle = BLE_GATT_HANDLE_INVALID;
 static uint8_t m_device_uid_buf[M_DEVICE_UID_SIZE] = {};
@@ -20,6 +24,13 @@ static uint8_t m_device_uid_buf[M_DEVICE_UID_SIZE] = {};
 static void on_sys_control_write(ble_gatts_evt_write_t const &event);
 BLE_GATT_WRITE_OBSERVER(m_sys_control_write, m_sys_control, on_sys_control_write);
 
+#if LED_PIPELINE_STATS
+static led::pipeline_stats m_pipeline_buf = {};
+
+static void on_pipeline_write(ble_gatts_evt_write_t const &event);
+BLE_GATT_WRITE_OBSERVER(m_pipeline_write, m_pipeline, on_pipeline_write);
+#endif
+
 CHARACTERISTIC_DEF(meta::service, device_uid_char,
     "Device UID",
     ble::char_uuid::meta_device_uid,
@@ -46,6 +57,17 @@ CHARACTERISTIC_DEF(meta::service, log_char,
     MAX_MESSAGE_LEN)
 {}
 
+#if LED_PIPELINE_STATS
+CHARACTERISTIC_DEF(meta::service, pipeline_char,
+    "LED Pipeline Stats",
+    ble::char_uuid::meta_pipeline,
+    ble_gatt_char_props_t { .read = true, .write = true },
+    (uint8_t*)&m_pipeline_buf,
+    sizeof(m_pipeline_buf),
+    sizeof(m_pipeline_buf))
+{}
+#endif
+
 meta::service::service(): ble::service(ble::service_uuid::meta)
 {}
 
@@ -74,6 +96,12 @@ ret_code_t meta::service::init()
         m_log.set_presentation_format(&pf);
         ret = add_characteristic(m_log);
         VERIFY_SUCCESS(ret);
+
+#if LED_PIPELINE_STATS
+        m_pipeline = meta::service::pipeline_char();
+        ret = add_characteristic(m_pipeline);
+        VERIFY_SUCCESS(ret);
+#endif
     }
 
     return ret;
@@ -146,3 +174,30 @@ void on_sys_control_write(ble_gatts_evt_write_t const &event)
 #endif
     }
 }
+
+#if LED_PIPELINE_STATS
+/*
+    CC                                  -> read the timings of LED channel CC
+    CC 01                               -> same, and start over afterwards
+*/
+void on_pipeline_write(ble_gatts_evt_write_t const &event)
+{
+    if (event.len < 1 || event.len > 2) {
+        NRF_LOG_WARNING("Invalid pipeline stats request");
+        return;
+    }
+
+    auto const clear = event.len == 2 && event.data[1] == 0x01;
+    auto ret = led::pipeline_snapshot(event.data[0], &m_pipeline_buf, clear);
+    if (ret != NRF_SUCCESS) {
+        NRF_LOG_WARNING("No LED channel %u", event.data[0]);
+        m_pipeline_buf = led::pipeline_stats {};
+    }
+
+    /* the write left the value as long as the request, reads get the whole snapshot */
+    ret = m_pipeline.set_value(&m_pipeline_buf, sizeof(m_pipeline_buf));
+    if (ret != NRF_SUCCESS) {
+        NRF_LOG_WARNING("Pipeline stats not set (%u)", ret);
+    }
+}
+#endif
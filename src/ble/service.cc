@@ -161,7 +161,8 @@ ret_code_t ble::characteristic::set_value(void const *data, size_t length)
     };
 
     if (buffer) {
-        if (data) {
+        /* the value may already be in the buffer, with only its length to set */
+        if (data && data != buffer) {
             memcpy(buffer, data, length);
         }
     } else {
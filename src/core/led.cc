@@ -6,6 +6,8 @@ NRF_LOG_MODULE_REGISTER();
 
 using namespace led;
 
+uint8_t led::zeros[LED_ZERO_REGION_SIZE] = {};
+
 void led::reset_all()
 {
     service_0().reset();
@@ -344,6 +344,22 @@ app_state userapp::get_app_state()
     return m_app_state;
 }
 
+bool userapp::is_default_app()
+{
+    bool result = false;
+
+    auto ret = with_desc(&result, [](void *context, desc &d) -> ret_code_t {
+        uint32_t arch = 0;
+        ret_code_t ret = d.architecture(arch);
+        VERIFY_SUCCESS(ret);
+
+        *(bool*)context = ((arch >> 16) & USERCODE_DEFAULT_APP_FLAGS) != 0;
+        return NRF_SUCCESS;
+    });
+
+    return ret == NRF_SUCCESS && result;
+}
+
 storage_state userapp::get_storage_state()
 {
     return m_storage_state;
@@ -379,12 +395,8 @@ void userapp::default_init(led_chan *chan)
         chan->color_mode = (uint8_t)led::color_mode::rgb;
     }
 
-    uint32_t i = 0;
-    for (uint16_t n = 0; n < chan->n_leds; n++) {
-        chan->buffer[i++] = 0; /* set red to 0 */
-        chan->buffer[i++] = 0; /* set green to 0 */
-        chan->buffer[i++] = 0; /* set blue to 0 */
-    }
+    /* red, green, blue and white (if any) to 0 */
+    memset(chan->buffer, 0, chan->channels * (size_t)chan->n_leds);
 }
 
 void userapp::default_refresh(led_chan *chan)
@@ -395,14 +407,28 @@ void userapp::default_refresh(led_chan *chan)
         chan->color_mode = (uint8_t)led::color_mode::rgb;
     }
 
+    uint16_t first = chan->n_leds;
+    uint16_t last = 0;
+
     if (chan->dmx_vals_len >= 3) {
+        /* slot 4 is the color mode, so white comes after it */
+        uint8_t value[4] = { chan->dmx_vals[0], chan->dmx_vals[1], chan->dmx_vals[2], 0 };
+        if (chan->dmx_vals_len >= 5) {
+            value[3] = chan->dmx_vals[4];
+        }
+
         uint32_t i = 0;
-        for (uint16_t n = 0; n < chan->n_leds; n++) {
-            chan->buffer[i++] = chan->dmx_vals[0];
-            chan->buffer[i++] = chan->dmx_vals[1];
-            chan->buffer[i++] = chan->dmx_vals[2];
+        for (uint16_t n = 0; n < chan->n_leds; n++, i += chan->channels) {
+            if (memcmp(&chan->buffer[i], value, chan->channels) == 0)
+                continue;
+            memcpy(&chan->buffer[i], value, chan->channels);
+            first = std::min(first, n);
+            last = n;
         }
     }
+
+    chan->dirty_first = first;
+    chan->dirty_count = first < chan->n_leds ? last - first + 1 : 0;
 }
 
 static void fds_callback(fds_evt_t const *event)
@@ -4,12 +4,20 @@
 #include "dmx/thread.hh"
 #include "meta.hh"
 #include "cfg.hh"
-#include "message_buffer.h"
 
 using namespace dmx;
 
 static void dmx_packet_task(void*);
 
+static meta::rdm_id_t m_rdm_uid;
+static meta::rdm_id_t const m_broadcast_rdm_uid = {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+
+/* the subscriber's own window, or the DMX config */
+static inline cfg::dmx_config_t const *window_of(thread::on_dmx_slot_vals_sub const *sub, cfg::dmx_config_t const *config)
+{
+    return sub->has_window ? &sub->window : config;
+}
+
 ret_code_t dmx::thread::init()
 {
     auto status = xTaskCreate(
@@ -34,9 +42,9 @@ ret_code_t dmx::thread::init()
     return ret;
 }
 
-void dmx::thread::set_frame_buf(MessageBufferHandle_t queue)
+void dmx::thread::set_transport(transport *tp)
 {
-    packet_queue_handle = queue;
+    rx_transport = tp;
     vTaskResume(packet_task_handle);
 }
 
@@ -45,25 +53,98 @@ ret_code_t dmx::thread::on_dmx_slot_vals(void *context, on_dmx_slot_vals_t callb
     if (!callback)
         return NRF_ERROR_NULL;
 
+    return add_slot_vals_sub(on_dmx_slot_vals_sub(callback, context), max_delay);
+}
+
+ret_code_t dmx::thread::on_dmx_slot_vals(void *context, on_dmx_slot_vals_t callback, cfg::param<cfg::dmx_config_t> window, TickType_t max_delay)
+{
+    if (!callback)
+        return NRF_ERROR_NULL;
+
+    ret_code_t ret = window.subscribe(this, [](void *context, void const *data, size_t length) {
+        auto self = (dmx::thread*)context;
+        self->windows_stale = true;
+    });
+    VERIFY_SUCCESS(ret);
+
+    return add_slot_vals_sub(on_dmx_slot_vals_sub(callback, context, window), max_delay);
+}
+
+ret_code_t dmx::thread::add_slot_vals_sub(on_dmx_slot_vals_sub const &sub, TickType_t max_delay)
+{
     on_dmx_slot_vals_sub *p = (decltype(p))pvPortMalloc(sizeof(*p));
+    if (!p)
+        return NRF_ERROR_NO_MEM;
+
     if (xSemaphoreTake(slot_vals_subs_mutex, max_delay)) {
-        p->callback = callback;
-        p->context = context;
+        *p = sub;
         p->next = slot_vals_subs;
         slot_vals_subs = p;
+        windows_stale = true;
         xSemaphoreGive(slot_vals_subs_mutex);
         return NRF_SUCCESS;
     } else {
+        vPortFree(p);
         return NRF_ERROR_BUSY;
     }
 }
 
-void dmx::thread::packet_task_func()
+/* Reload the windows of the subscribers that have one, and tell those whose
+ * window changed. Subscribers are only ever added at the head of the list,
+ * so it can be walked without the mutex while the windows are read from
+ * `cfg`, which may be calling `on_channel_cfg_update` with its lock held. */
+void thread::load_windows(cfg::dmx_config_t const *config)
+{
+    windows_stale = false;
+
+    xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
+    auto const subs = slot_vals_subs;
+    xSemaphoreGive(slot_vals_subs_mutex);
+
+    for (auto cb = subs; cb; cb = cb->next) {
+        if (!cb->has_window_param) {
+            continue;
+        }
+
+        cfg::dmx_config_t window;
+        auto const has_window = cb->window_param.get(&window) == NRF_SUCCESS && window.channel > 0;
+
+        xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
+        if (has_window != cb->has_window ||
+            (has_window && memcmp(&window, &cb->window, sizeof(window)) != 0))
+        {
+            cb->has_window = has_window;
+            cb->window = window;
+            cb->is_current = false;
+            cb->callback(cb->context, nullptr, window_of(cb, config));
+        }
+        xSemaphoreGive(slot_vals_subs_mutex);
+    }
+}
+
+/* bytes up to the last subscribed slot of any subscriber, start code included */
+size_t thread::frame_size(cfg::dmx_config_t const *config)
 {
-    static meta::rdm_id_t my_rdm_uid;
-    static meta::rdm_id_t broadcast_rdm_uid = {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+    size_t n_bytes = 0;
+
+    xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
+    for (auto cb = slot_vals_subs; cb; cb = cb->next) {
+        auto const window = window_of(cb, config);
+        if (window->channel == 0) {
+            continue;
+        }
+
+        auto const end = window->channel + std::min((size_t)window->n_channels, (size_t)MAX_USER_APP_SLOTS);
+        n_bytes = std::max(n_bytes, end);
+    }
+    xSemaphoreGive(slot_vals_subs_mutex);
+
+    return n_bytes;
+}
 
-    my_rdm_uid = meta::device_rdm_uid();
+void dmx::thread::packet_task_func()
+{
+    m_rdm_uid = meta::device_rdm_uid();
 
     ret_code_t ret;
     auto config = cfg::dmx::config;
@@ -83,92 +164,161 @@ void dmx::thread::packet_task_func()
     }
     APP_ERROR_CHECK(ret);
 
+    load_windows(&dcfg);
+
     xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
     for (auto cb = slot_vals_subs; cb; cb = cb->next) {
-        cb->callback(cb->context, nullptr, &dcfg);
+        /* those with a window were told by `load_windows` */
+        if (!cb->has_window) {
+            cb->callback(cb->context, nullptr, &dcfg);
+        }
     }
     xSemaphoreGive(slot_vals_subs_mutex);
 
+    bool window_changed = true;
+
     while (1) {
-        if (!packet_queue_handle)
+        if (!rx_transport)
             vTaskSuspend(nullptr);
 
-        auto nread = xMessageBufferReceive(packet_queue_handle, rx_buffer, sizeof(rx_buffer), portMAX_DELAY);
+        /* dimmer frames are complete once the subscribed slots are in */
+        if (window_changed) {
+            rx_transport->set_frame_size(frame_size(&dcfg));
+            window_changed = false;
+        }
+
+        /* the frame is read in the transport's buffer, and handed back when done */
+        rx_frame frame;
+        if (rx_transport->receive(&frame, portMAX_DELAY) != NRF_SUCCESS) {
+            continue;
+        }
 
         {
             task::lock_guard<cfg::dmx_config_t> guard;
             if (dmx_config.take(guard, 0)) {
+                window_changed = memcmp(&dcfg, guard.as_ptr(), sizeof(cfg::dmx_config_t)) != 0;
                 memcpy(&dcfg, guard.as_ptr(), sizeof(cfg::dmx_config_t));
             }
         }
 
-        /* DMX512 */
-        if (dcfg.channel > 0 &&                             /* a subscription has been set, and... */
-            nread > dcfg.channel &&                         /* the buffer contains data for the subscribed channels, and... */
-            rx_buffer[0] == (uint8_t)start_code::dimmer)    /* this is a dimmer packet, and... */
-        {
-            auto chan_data = &rx_buffer[dcfg.channel];
-            auto n_chan_datas = std::min(nread, (size_t)dcfg.n_channels);
-            auto slot_vals = dmx_slot_vals { n_chan_datas, chan_data };
-
-            xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
-            for (auto cb = slot_vals_subs; cb; cb = cb->next) {
-                cb->callback(cb->context, &slot_vals, &dcfg);
-            }
-            xSemaphoreGive(slot_vals_subs_mutex);
+        if (windows_stale) {
+            load_windows(&dcfg);
+            window_changed = true;
         }
 
-        /* RDM */
-        if (nread >= 26 &&
-            nread <= 257 &&
-            rx_buffer[0] == (uint8_t)start_code::rdm &&
-            rx_buffer[1] == (uint8_t)rdm_sub::message && 
-            rx_buffer[2] == nread - 2 && (
-                memcmp(&rx_buffer[3], my_rdm_uid.bytes, 6) == 0 ||
-                memcmp(&rx_buffer[3], broadcast_rdm_uid.bytes, 6) == 0))
-        {
-            auto checksum_ofs = rx_buffer[2];
-            auto const got_checksum = uint16_big_decode(&rx_buffer[checksum_ofs]);
-            uint16_t expect_checksum = 0;
-            for (size_t i = 0; i < checksum_ofs; ++i) {
-                expect_checksum += rx_buffer[i];
-            }
+        on_frame(frame.data, frame.length, &dcfg);
+        rx_transport->release(frame);
+    }
+}
 
-            if (got_checksum != expect_checksum) {
-                NRF_LOG_WARNING("RDM checksum mismatch (expected=0x%04x got=0x%04x)", expect_checksum, got_checksum);
+void thread::on_frame(uint8_t const *frame, size_t nread, cfg::dmx_config_t const *config)
+{
+    /* DMX512, each subscriber gets its slots straight from the frame */
+    if (frame[0] == (uint8_t)start_code::dimmer) {
+        auto const now = xTaskGetTickCount();
+
+        xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
+        for (auto cb = slot_vals_subs; cb; cb = cb->next) {
+            auto const window = window_of(cb, config);
+            if (window->channel == 0 ||                 /* a subscription has been set, and... */
+                nread <= window->channel)               /* the buffer contains data for the subscribed channels */
+            {
                 continue;
             }
 
-            if (rx_buffer[23] != nread - 26) {
-                NRF_LOG_WARNING("RDM PDL (%u) does not match ML (%u)", rx_buffer[23], rx_buffer[2]);
-                continue;
-            }
+            auto chan_data = &frame[window->channel];
+            auto n_chan_datas = std::min(nread - window->channel, (size_t)window->n_channels);
+
+            notify_sub(cb, n_chan_datas, chan_data, window, now);
+        }
+        xSemaphoreGive(slot_vals_subs_mutex);
+    }
 
-            // meta::rdm_id_t source_rdm_uid;
-            // memcpy(source_rdm_uid.bytes, &rx_buffer[9], 6);
+    /* RDM, followed by the break, which may have been received as a 0 */
+    if (nread >= 26 &&
+        frame[0] == (uint8_t)start_code::rdm &&
+        frame[1] == (uint8_t)rdm_sub::message && 
+        frame[2] >= 24 &&
+        nread >= frame[2] + 2u && (
+            memcmp(&frame[3], m_rdm_uid.bytes, 6) == 0 ||
+            memcmp(&frame[3], m_broadcast_rdm_uid.bytes, 6) == 0))
+    {
+        auto checksum_ofs = frame[2];
+        auto const got_checksum = uint16_big_decode(&frame[checksum_ofs]);
+        uint16_t expect_checksum = 0;
+        for (size_t i = 0; i < checksum_ofs; ++i) {
+            expect_checksum += frame[i];
+        }
 
-            // auto const tn = rx_buffer[15];
-            // auto const port_id = rx_buffer[16];
-            // auto const msg_count = rx_buffer[17];
-            // auto const sub_device = uint16_big_decode(&rx_buffer[18]);
-            // auto const msg_len = rx_buffer[2] - 20;
+        if (got_checksum != expect_checksum) {
+            NRF_LOG_WARNING("RDM checksum mismatch (expected=0x%04x got=0x%04x)", expect_checksum, got_checksum);
+            return;
+        }
 
-            // auto const msg_body = (uint8_t const*)&rx_buffer[20];
+        if (frame[23] != frame[2] - 24) {
+            NRF_LOG_WARNING("RDM PDL (%u) does not match ML (%u)", frame[23], frame[2]);
+            return;
         }
+
+        // meta::rdm_id_t source_rdm_uid;
+        // memcpy(source_rdm_uid.bytes, &frame[9], 6);
+
+        // auto const tn = frame[15];
+        // auto const port_id = frame[16];
+        // auto const msg_count = frame[17];
+        // auto const sub_device = uint16_big_decode(&frame[18]);
+        // auto const msg_len = frame[2] - 20;
+
+        // auto const msg_body = (uint8_t const*)&frame[20];
     }
 }
 
 ret_code_t thread::send(dmx_slot_vals const *slot_vals)
 {
     dassert(!task::is_in_isr());
+
+    auto const now = xTaskGetTickCount();
+
+    /* the mutex also keeps the packet task and `send` from writing at the same time */
     xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
     for (auto cb = slot_vals_subs; cb; cb = cb->next) {
-        cb->callback(cb->context, slot_vals, nullptr);
+        notify_sub(cb, slot_vals->n_vals, slot_vals->vals, nullptr, now);
     }
     xSemaphoreGive(slot_vals_subs_mutex);
+
     return NRF_SUCCESS;
 }
 
+/* Publish the values for the subscriber to read a snapshot of, and call it
+ * if it hasn't got them yet. Values that are identical to the last ones are
+ * not published again, so readers can tell changes by the version alone.
+ * Called with the mutex held. */
+void thread::notify_sub(on_dmx_slot_vals_sub *sub, size_t n_vals, uint8_t const *vals, cfg::dmx_config_t const *config, TickType_t now)
+{
+    n_vals = std::min(n_vals, sizeof(slot_frame::vals));
+
+    auto const &last = sub->vals.peek();
+    if (last.n_vals != n_vals || memcmp(last.vals, vals, n_vals) != 0) {
+        auto next = sub->vals.begin_write();
+        next->n_vals = n_vals;
+        memcpy(next->vals, vals, n_vals);
+        sub->vals.publish();
+        sub->is_current = false;
+    }
+
+    if (sub->is_current &&
+        (DMX_SLOT_VALS_REFRESH_MSEC == 0 || now - sub->notified_at < pdMS_TO_TICKS(DMX_SLOT_VALS_REFRESH_MSEC)))
+    {
+        return;
+    }
+
+    sub->is_current = true;
+    sub->notified_at = now;
+
+    auto const slot_vals_evt = dmx_slot_vals { n_vals, vals, &sub->vals };
+    sub->callback(sub->context, &slot_vals_evt, config);
+}
+
 void thread::slot_vals_task_func()
 {
     vTaskSuspend(nullptr);
@@ -186,8 +336,14 @@ void thread::on_channel_cfg_update(cfg::dmx_config_t const *config)
         }
     }
 
+    /* the subscribed slots may have moved, except for subscribers with their own window */
     xSemaphoreTake(slot_vals_subs_mutex, portMAX_DELAY);
     for (auto cb = slot_vals_subs; cb; cb = cb->next) {
+        if (cb->has_window) {
+            continue;
+        }
+
+        cb->is_current = false;
         cb->callback(cb->context, nullptr, config);
     }
     xSemaphoreGive(slot_vals_subs_mutex);
@@ -0,0 +1,30 @@
+#include "prelude.hh"
+#include "led/arena.hh"
+
+using namespace led;
+
+/* in RAM because EasyDMA can't read from flash */
+static uint8_t m_arena[LED_ARENA_SIZE] align(sizeof(uint32_t));
+
+uint8_t *led::arena_base()
+{
+    return m_arena;
+}
+
+void led::arena_move(uint8_t * const *from, uint8_t * const *to, size_t const *keep, size_t n)
+{
+    /* Regions keep their order, so everything in front of a region that
+     * moves down has already moved out of its way when it is moved first,
+     * and likewise behind a region that moves up when it is moved last. */
+    for (size_t i = 0; i < n; ++i) {
+        if (to[i] < from[i] && keep[i] > 0) {
+            memmove(to[i], from[i], keep[i]);
+        }
+    }
+
+    for (size_t i = n; i-- > 0;) {
+        if (to[i] > from[i] && keep[i] > 0) {
+            memmove(to[i], from[i], keep[i]);
+        }
+    }
+}
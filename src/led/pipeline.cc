@@ -0,0 +1,48 @@
+#include "prelude.hh"
+#include "led/pipeline.hh"
+
+using namespace led;
+
+void stage_stats::record(uint32_t cycles)
+{
+    if (count == 0) {
+        min = cycles;
+        max = cycles;
+        avg = cycles;
+    } else {
+        min = std::min(min, cycles);
+        max = std::max(max, cycles);
+        avg = (uint32_t)((int32_t)avg + ((int32_t)(cycles - avg) >> 4));
+    }
+
+    if (count < UINT32_MAX)
+        count += 1;
+
+    /* bin b >= 1 holds [2^(8+2b), 2^(10+2b)) cycles */
+    uint32_t const bits = 32 - __builtin_clz(cycles | 1);
+    auto const bin = bits <= 10 ? 0 : std::min<size_t>((bits - 9) / 2, pipeline_hist_bins - 1);
+
+    if (hist[bin] < UINT16_MAX)
+        hist[bin] += 1;
+}
+
+#if LED_PIPELINE_STATS
+void pipeline_probe::init()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void pipeline_probe::record_slack(uint32_t start, TickType_t period)
+{
+    uint32_t const elapsed = (wall_clock() - start) & RTC_COUNTER_COUNTER_Msk;
+    uint32_t const due = period * (LED_PIPELINE_RTC_HZ / configTICK_RATE_HZ);
+
+    if (elapsed > due) {
+        stats.late += 1;
+        stats.record(pipeline_stage::slack, 0);
+    } else {
+        stats.record(pipeline_stage::slack, wall_to_cycles(due - elapsed));
+    }
+}
+#endif
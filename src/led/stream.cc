@@ -0,0 +1,117 @@
+#include "prelude.hh"
+#include "led/stream.hh"
+
+using namespace led;
+
+void stream::set_frame(uint8_t const *p, size_t n)
+{
+    pixels = p;
+    n_pixels = n;
+    pos = 0;
+}
+
+size_t stream::fill(size_t idx)
+{
+    assert(encoder != nullptr);
+    assert(idx < 2);
+
+    auto const led_size = encoder->led_size();
+    auto const reset_size = encoder->reset_size();
+    auto const header_size = encoder->header_size();
+    auto const data_start = reset_size + header_size;
+    auto const data_end = data_start + n_pixels * led_size;
+    auto const end = data_end + reset_size;
+    auto const out = chunks[idx];
+
+    assert(led_size <= sizeof(chunks[idx]));
+
+    size_t n = 0;
+
+    while (n < sizeof(chunks[idx]) && pos < end) {
+        if (pos < reset_size || pos >= data_end) {
+            /* leading or trailing bus reset */
+            auto const zeros = std::min(sizeof(chunks[idx]) - n, (pos < reset_size ? reset_size : end) - pos);
+            memset(&out[n], 0, zeros);
+            n += zeros;
+            pos += zeros;
+        } else if (pos < data_start) {
+            auto const copy = std::min(sizeof(chunks[idx]) - n, data_start - pos);
+            memcpy(&out[n], &encoder->header()[pos - reset_size], copy);
+            n += copy;
+            pos += copy;
+        } else {
+            /* only whole LEDs go into a chunk */
+            auto const first = (pos - data_start) / led_size;
+            auto const count = std::min((sizeof(chunks[idx]) - n) / led_size, n_pixels - first);
+            if (count == 0)
+                break;
+            if (encoder->channels() == 4) {
+                encoder->encode_rgbw((color::rgbw const*)&pixels[first * sizeof(color::rgbw)], count, &out[n]);
+            } else {
+                encoder->encode((color::rgb const*)&pixels[first * sizeof(color::rgb)], count, &out[n]);
+            }
+            n += count * led_size;
+            pos += count * led_size;
+        }
+    }
+
+    return n;
+}
+
+namespace {
+    template<size_t Channels>
+    struct pixel_encoder {
+        constexpr static size_t channels = Channels;
+        constexpr static size_t bytes_per_led = Channels;
+
+        static inline void encode_led(color::rgb const &value, uint8_t *out)
+        {
+            memcpy(out, &value, sizeof(value));
+        }
+
+        static inline void encode_led(color::rgbw const &value, uint8_t *out)
+        {
+            memcpy(out, &value, sizeof(value));
+        }
+    };
+}
+
+ret_code_t pixel_frame::write(color::rgb &value)
+{
+    if (n_channels == 4) {
+        auto const with_white = color::rgbw(value, 0);
+        return output.write(&with_white, sizeof(with_white));
+    }
+
+    return output.write(&value, sizeof(value));
+}
+
+void pixel_frame::encode(color::rgb const *values, size_t n, uint8_t *out)
+{
+    if (n_channels == 4) {
+        for (size_t i = 0; i < n; ++i, out += sizeof(color::rgbw)) {
+            auto const with_white = color::rgbw(values[i], 0);
+            memcpy(out, &with_white, sizeof(with_white));
+        }
+        return;
+    }
+
+    memcpy(out, values, n * sizeof(color::rgb));
+}
+
+void pixel_frame::encode_rgbw(color::rgbw const *values, size_t n, uint8_t *out)
+{
+    if (n_channels == 4) {
+        memcpy(out, values, n * sizeof(color::rgbw));
+        return;
+    }
+
+    transcode::encode_rgbw(values, n, out);
+}
+
+render_loop_t pixel_frame::render_loop(color_mode mode, bool corrected, bool extract_white)
+{
+    return n_channels == 4
+        ? select_render_loop<pixel_encoder<4>>(mode, corrected, extract_white)
+        : select_render_loop<pixel_encoder<3>>(mode, corrected, extract_white);
+}
@@ -3,35 +3,51 @@
 #include "led.hh"
 #include "time.hh"
 #include "cfg.hh"
+#include "task.hh"
 
 using namespace led;
 
 #define CFG_UPDATE_INTERVAL_MSEC 3000
-#define SEND_COMPLETE 0x12345678
 #define DO_RENDER     0xcdef0123
 
 static size_t m_n_led_threads = 0;
-static TaskHandle_t m_led_threads[MAX_LED_CHANNELS];
+static thread *m_led_threads[MAX_LED_CHANNELS];
+static TaskHandle_t m_scheduler = nullptr;
+static volatile bool m_arena_dirty = false;
 
-static void led_task_func(void *context);
+static void scheduler_func(void *context);
+
+/* the RTC that drives the FreeRTOS tick, see LED_PIPELINE_RTC_HZ */
+static inline uint32_t rtc_counts()
+{
+    return portNRF_RTC_REG->COUNTER;
+}
 
 ret_code_t thread::init(char const *name)
 {
-    if (++m_n_led_threads > MAX_LED_CHANNELS) {
+    /* every channel is served by the one scheduler task */
+    unused(name);
+
+    if (m_n_led_threads >= MAX_LED_CHANNELS) {
         return NRF_ERROR_INVALID_STATE;
     }
 
+    m_led_threads[m_n_led_threads++] = this;
+    pipeline_probe::init();
+
+    if (m_scheduler) {
+        return NRF_SUCCESS;
+    }
+
     auto result = xTaskCreate(
-        led_task_func,
-        name,
-        256,
-        this,
+        scheduler_func,
+        "LED",
+        LED_SCHEDULER_STACK_SIZE,
+        nullptr,
         4,
-        &handle
+        &m_scheduler
     );
 
-    m_led_threads[m_n_led_threads-1] = handle;
-
     if (result != pdPASS) {
         return NRF_ERROR_NO_MEM;
     } else {
@@ -39,19 +55,42 @@ ret_code_t thread::init(char const *name)
     }
 }
 
-
-void thread::task_func()
+void thread::enable()
 {
-    /* suspend until the userapp thread calls led::resume_all() */
-    vTaskSuspend(handle);
+    enabled = true;
+    if (m_scheduler) {
+        xTaskNotifyGive(m_scheduler);
+    }
+}
 
+void thread::start()
+{
     assert(render_config_param != nullptr);
-    assert(tc[0] != nullptr);
-    assert(tc[1] != nullptr);
     assert(tp != nullptr);
 
+    /* bus resets are sent from `led::zeros`, and headers from the transcoder, instead of being stored in each frame */
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        auto const frame = frames.frame(i);
+        assert(frame != nullptr);
+        frame->omit_bus_reset(frame->reset_size() <= sizeof(zeros));
+    }
+
+    /* frames of a streaming thread hold pixels the way the stream's encoder takes them */
+    if (strm) {
+        for (size_t i = 0; i < n_frame_buffers; ++i) {
+            static_cast<pixel_frame*>(frames.frame(i))->set_channels(strm->channels());
+        }
+    }
+
+    /* frames that were created without a buffer are placed in the arena */
+    arena_frames = 0;
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        if (frames.frame(i)->ptr() == nullptr) {
+            arena_frames |= 1 << i;
+        }
+    }
+
     ret_code_t ret;
-    uint8_t tc_idx = 0;
 
     /* retrieve the renderer config, or set up default if it is unavailable */
     ret = render_config_param->get(&render_config);
@@ -62,6 +101,7 @@ void thread::task_func()
         ret = render_config_param->set(&render_config);
     }
     APP_ERROR_CHECK(ret);
+    refresh_msec = render_config.refresh_msec;
 
     /* subscribe to the renderer config */
     ret = render_config_param->subscribe(this, [](void *context, void const *data, size_t size) {
@@ -83,87 +123,620 @@ void thread::task_func()
     });
 
     /* set initial values in the renderer */
-    auto props = renderer_props {
-        .render_config = render_config
+    props = renderer_props {
+        .render_config = render_config,
+        .max_frame_rate = max_frame_rate(),
+        .refresh_msec = refresh_interval_msec()
     };
     render->init_render(props);
 
-    auto cur_tc = tc[tc_idx];
+    /* the transport starts out with an all-black frame */
+    blank_sent_frame(MAX_LEDS_PER_THREAD);
 
-    cur_tc->clear();
-    cur_tc->write_bus_reset();
-    auto off = color::rgb(color::BLACK);
-    for (size_t i = 0; i < MAX_LEDS_PER_THREAD; ++i) {
-        cur_tc->write(off);
+    has_sent = false;
+    last_send = time::ticks();
+    deadline = last_send;
+    started = true;
+
+    /* the channel gets its share of the arena before its first frame */
+    m_arena_dirty = true;
+}
+
+/* whether tick `a` comes before tick `b` */
+static inline bool is_before(TickType_t a, TickType_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+TickType_t thread::next_deadline(TickType_t now)
+{
+    if (!genlock) {
+        return deadline;
     }
-    cur_tc->write_bus_reset();
 
-    ret = tp->set_buffer(cur_tc->ptr(), cur_tc->len());
-    APP_ERROR_CHECK(ret);
+    /* a frame that is waiting for the transport goes out as soon as it is free */
+    if (frames.is_pending() && tp->is_ready()) {
+        return now;
+    }
 
-    while (1) {
-        auto now = time::ticks();
+    /* input is rendered once the last frame has had time to go out */
+    if (triggered) {
+        auto const earliest = last_render + min_interval;
+        auto const due = is_before(trigger_tick, earliest) ? earliest : trigger_tick;
+        return is_before(due, deadline) ? due : deadline;
+    }
+
+    return deadline;
+}
 
-        /* send the buffer */
-        ret = tp->send();
-        APP_ERROR_CHECK(ret);
+void thread::run_frame(TickType_t now)
+{
+    if (!genlock) {
+        auto const scheduled = deadline;
+        auto const frame_start = probe.start_frame();
 
-        /* call the renderer on the other buffer */
-        tc_idx = (tc_idx + 1) & 1;
-        cur_tc = tc[tc_idx];
+        /* the newest frame goes out at the start of the interval, then the next one is rendered */
+        send_latest(scheduled);
+        render_latest();
 
-        props.render_config = render_config;
-        props.dmx_config = dmx_config;
-        memcpy(props.dmx_vals, dmx_vals, std::min(sizeof(props.dmx_vals), sizeof(dmx_vals)));
+        auto const interval = period();
+        probe.record_slack(frame_start, interval);
 
-        if (render) {
-            cur_tc->clear();
-            ret = render->render(cur_tc, props);
-            APP_ERROR_CHECK(ret);
+        /* like vTaskDelayUntil, but frames that are already late are not made up for */
+        deadline = scheduled + interval;
+        if (is_before(deadline, now)) {
+            deadline = now;
         }
+        return;
+    }
 
-        /* wait until `send()` is finished */
-        uint32_t nv = 0;
-        auto notify = xTaskNotifyWait(0, UINT32_MAX, &nv, pdMS_TO_TICKS(refresh_msec));
-        if (notify != pdPASS) {
-            NRF_LOG_WARNING("Missed TX notification")
+    auto const render_due = !is_before(now, deadline) || (triggered && !is_before(now, last_render + min_interval));
+
+    if (render_due) {
+        probe.start_frame();
+        triggered = false;
+        last_render = now;
+        deadline = now + period();
+        render_latest();
+    }
+
+    /* send it right away, or as soon as the transport is free */
+    send_latest(now);
+}
+
+void thread::send_latest(TickType_t now)
+{
+    ret_code_t ret;
+
+    /* Hand the latest completed frame to the transport. If it is still
+     * busy, the frame stays in the mailbox, and may be replaced by a
+     * newer one before the next attempt. */
+    if (!tp->is_ready()) {
+        return;
+    }
+
+    auto next = frames.take();
+    auto input = next ? frames.sent_tag() : no_input;
+    auto const keepalive_due = keepalive_msec > 0 && now - last_send >= pdMS_TO_TICKS(keepalive_msec);
+
+    /* without a new frame, re-send the last one unless idle frames are skipped */
+    if (!next && (!has_sent || !skip_idle || keepalive_due)) {
+        if (has_sent) {
+            frames.repeat();
         }
+        next = frames.sent_frame();
+    }
+
+    if (!next) {
+        return;
+    }
 
-        /* switch to other buffer */
-        ret = tp->set_buffer(cur_tc->ptr(), cur_tc->len());
-        APP_ERROR_CHECK(ret);
+    ret = set_frame(next);
+    APP_ERROR_CHECK(ret);
+
+    probe.start_tx(input);
+    ret = tp->send();
+    APP_ERROR_CHECK(ret);
+    last_send = now;
+    has_sent = true;
+}
+
+void thread::render_latest()
+{
+    ret_code_t ret;
 
-        vTaskDelayUntil(&now, pdMS_TO_TICKS(refresh_msec));
+    /* the oldest input that this frame shows */
+    uint32_t input = no_input;
+    CRITICAL_REGION_ENTER();
+        if (input_pending) {
+            input = input_at;
+            input_pending = false;
+        }
+    CRITICAL_REGION_EXIT();
+
+    /* DMX values are only copied when a new frame was published */
+    bool dmx_changed = false;
+    auto const source = dmx_source;
+    if (source) {
+        dmx_changed = source->read(&dmx_version, [this](dmx::slot_frame const &frame) {
+            memcpy(props.dmx_vals, frame.vals, frame.n_vals);
+            memset(&props.dmx_vals[frame.n_vals], 0, sizeof(props.dmx_vals) - frame.n_vals);
+        });
+    }
+
+    /* skip the frame if nothing has changed */
+    auto const changed = inputs_changed || dmx_changed;
+    inputs_changed = false;
+    auto const idle = skip_idle && render && !changed && render->is_idle();
+
+    if (!render || idle) {
+        return;
+    }
+
+    /* the arena has no room for this channel's frames */
+    if (arena_frames && slice.len == 0) {
+        return;
+    }
+
+    props.render_config = render_config;
+    props.dmx_config = dmx_config;
+    props.max_frame_rate = max_frame_rate();
+    props.refresh_msec = refresh_interval_msec();
+
+    /* render into the buffer that is neither being sent nor waiting to be */
+    auto const target = frames.render_target();
+    target->clear();
+    auto const render_start = probe.cycles();
+    auto const render_counts = rtc_counts();
+    ret = render->render(target, props);
+    APP_ERROR_CHECK(ret);
+    probe.record(pipeline_stage::render, render_start);
+    record_render_cost((rtc_counts() - render_counts) & RTC_COUNTER_COUNTER_Msk);
+
+#if LED_PIPELINE_STATS
+    /* renderers that don't keep stats don't report their stages either */
+    auto const stats = render->stats();
+    if (stats.frames > 0) {
+        probe.record_cycles(pipeline_stage::refresh, stats.refresh_cycles);
+        probe.record_cycles(pipeline_stage::transcode, stats.transcode_cycles);
+    }
+#endif
+
+    frames.publish(input);
+}
+
+void thread::trigger()
+{
+    dassert(!task::is_in_isr());
+
+    CRITICAL_REGION_ENTER();
+        if (!input_pending) {
+            input_pending = true;
+            input_at = probe.wall_clock();
+        }
+        if (!triggered) {
+            triggered = true;
+            trigger_tick = time::ticks();
+        }
+    CRITICAL_REGION_EXIT();
+
+    if (genlock && m_scheduler) {
+        xTaskNotifyGive(m_scheduler);
+    }
+}
+
+void renderer::commit()
+{
+    if (owner) {
+        owner->trigger();
     }
 }
 
 void thread::set_renderer(renderer *r)
 {
     render = r;
+    if (r) {
+        r->owner = this;
+    }
+}
+
+ret_code_t thread::set_frame(transcode *frame)
+{
+    auto const reset_size = frame->reset_size();
+
+    if (strm) {
+        strm->set_frame(frame->ptr(), frame->len() / frame->led_size());
+        set_airtime(strm->length());
+        return tp->set_stream(strm);
+    } else if (reset_size > sizeof(zeros)) {
+        set_airtime(frame->len());
+        return tp->set_buffer(frame->ptr(), frame->len());
+    }
+
+    auto const header_size = frame->header_size();
+    set_airtime(2 * reset_size + header_size + frame->len());
+
+    size_t n = 0;
+    segs[n++] = { .data = zeros, .length = reset_size };
+    if (header_size) {
+        segs[n++] = { .data = frame->header(), .length = header_size };
+    }
+    segs[n++] = { .data = frame->ptr(), .length = frame->len() };
+    segs[n++] = { .data = zeros, .length = reset_size };
+
+    return tp->set_segments(segs, n);
+}
+
+void thread::set_airtime(size_t n_bytes)
+{
+    auto const rate = tp->byte_rate();
+
+    if (rate == 0) {
+        min_interval = pdMS_TO_TICKS(MINIMUM_REFRESH_RATE_MSEC);
+    } else {
+        min_interval = (TickType_t)(((uint64_t)n_bytes * configTICK_RATE_HZ + rate - 1) / rate);
+    }
+
+    min_interval = std::max<TickType_t>(min_interval, 1);
+}
+
+void thread::record_render_cost(uint32_t counts)
+{
+    /* rises at once, and decays over roughly 16 frames */
+    if (counts >= render_cost) {
+        render_cost = counts;
+    } else {
+        render_cost -= (render_cost - counts + 15) / 16;
+    }
+}
+
+TickType_t thread::render_ticks() const
+{
+    return (TickType_t)(((uint64_t)render_cost * configTICK_RATE_HZ + LED_PIPELINE_RTC_HZ - 1) / LED_PIPELINE_RTC_HZ);
+}
+
+TickType_t thread::frame_floor() const
+{
+    return std::max<TickType_t>(min_interval, render_ticks());
+}
+
+TickType_t thread::period() const
+{
+    if (refresh_msec == LED_REFRESH_AUTO) {
+        /* Rendering at the scheduler's priority would otherwise starve DMX,
+         * the user apps and BLE whenever it takes longer than the airtime.
+         * Waiting for the render time of every channel, scaled up by the
+         * share, keeps all channels together within it. */
+        TickType_t all_channels = 0;
+        for (size_t i = 0; i < m_n_led_threads; ++i) {
+            all_channels += m_led_threads[i]->is_started() ? m_led_threads[i]->render_ticks() : 0;
+        }
+        auto const budget = (TickType_t)(((uint64_t)all_channels * 100 + LED_AUTO_RENDER_SHARE - 1) / LED_AUTO_RENDER_SHARE);
+
+        return std::max({ frame_floor(), budget, pdMS_TO_TICKS(MINIMUM_REFRESH_RATE_MSEC) });
+    }
+
+    /* a shorter interval than the strip allows would only drop frames */
+    return std::max<TickType_t>(pdMS_TO_TICKS(refresh_msec), frame_floor());
 }
 
 void thread::on_send_complete(BaseType_t *do_context_switch)
 {
-    auto status = xTaskNotifyFromISR(handle, SEND_COMPLETE, eSetValueWithoutOverwrite, do_context_switch);
-    assert(status == pdPASS);
+    probe.end_tx();
+
+    /* in genlock mode, a frame that was rendered meanwhile goes out right away */
+    if (genlock && frames.is_pending()) {
+        vTaskNotifyGiveFromISR(m_scheduler, do_context_switch);
+    }
 }
 
 void thread::on_render_config_change(cfg::led_render_t *config)
 {
     NRF_LOG_DEBUG("config change: mode=%u, nleds=%u, refresh=%u", config->color_mode, config->n_leds, config->refresh_msec);
     render_config = *config;
+    refresh_msec = config->refresh_msec;
+    inputs_changed = true;
+
+    if (config->n_leds != slice.n_leds) {
+        m_arena_dirty = true;
+        if (m_scheduler) {
+            xTaskNotifyGive(m_scheduler);
+        }
+    }
+}
+
+size_t thread::pixel_bytes(size_t n_leds)
+{
+    return render ? render->arena_bytes_per_led(channels()) * n_leds : 0;
+}
+
+size_t thread::arena_bytes(size_t n_leds)
+{
+    auto n = arena_align(pixel_bytes(n_leds));
+
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        if (arena_frames & (1 << i)) {
+            n += arena_align(frames.frame(i)->bytes_for(n_leds));
+        }
+    }
+
+    return n;
+}
+
+/* the most LEDs whose pixels and frames fit in `n_bytes` of the arena */
+size_t thread::arena_fit(size_t n_bytes)
+{
+    auto const fixed = arena_bytes(0);
+    auto per_led = pixel_bytes(1);
+
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        if (arena_frames & (1 << i)) {
+            per_led += frames.frame(i)->led_size();
+        }
+    }
+
+    if (per_led == 0) {
+        return UINT16_MAX;
+    } else if (n_bytes < fixed) {
+        return 0;
+    }
+
+    /* alignment adds less than a word per region */
+    auto n = std::min<size_t>((n_bytes - fixed) / per_led, UINT16_MAX);
+    while (n > 0 && arena_bytes(n) > n_bytes) {
+        n -= 1;
+    }
+
+    return n;
+}
+
+size_t thread::max_leds()
+{
+    size_t others = 0;
+    for (size_t i = 0; i < m_n_led_threads; ++i) {
+        if (m_led_threads[i] != this) {
+            others += m_led_threads[i]->slice.len;
+        }
+    }
+
+    auto n = arena_fit(LED_ARENA_SIZE - std::min<size_t>(others, LED_ARENA_SIZE));
+
+    /* frames with a buffer of their own can't grow */
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        if (!(arena_frames & (1 << i))) {
+            n = std::min(n, frames.frame(i)->max_leds());
+        }
+    }
+
+    return n;
+}
+
+void thread::place(arena_slice const &to)
+{
+    auto p = to.ptr;
+    auto const pixels = pixel_bytes(to.n_leds);
+
+    slice = to;
+
+    if (render) {
+        render->set_arena(pixels ? p : nullptr, to.n_leds, channels());
+    }
+    p += arena_align(pixels);
+
+    for (size_t i = 0; i < n_frame_buffers; ++i) {
+        if (arena_frames & (1 << i)) {
+            auto const len = to.len ? frames.frame(i)->bytes_for(to.n_leds) : 0;
+            frames.frame(i)->set_output(len ? p : nullptr, len);
+            p += arena_align(len);
+        }
+    }
+}
+
+void thread::blank_sent_frame(size_t n_leds)
+{
+    auto const frame = frames.sent_frame();
+    auto off = color::rgb(color::BLACK);
+    n_leds = std::min(n_leds, frame->max_leds());
+
+    frame->clear();
+    frame->write_frame_start();
+    for (size_t i = 0; i < n_leds; ++i) {
+        frame->write(off);
+    }
+    frame->write_bus_reset();
+}
+
+void thread::wait_until_sent()
+{
+    while (!tp->is_ready()) {
+        vTaskDelay(1);
+    }
+}
+
+static inline bool is_same_slice(arena_slice const &a, arena_slice const &b)
+{
+    return a.ptr == b.ptr && a.len == b.len && a.n_leds == b.n_leds;
+}
+
+void thread::repartition_arena()
+{
+    ret_code_t ret;
+    arena_slice to[MAX_LED_CHANNELS];
+    uint8_t *from_ptrs[MAX_LED_CHANNELS];
+    uint8_t *to_ptrs[MAX_LED_CHANNELS];
+    size_t keep[MAX_LED_CHANNELS];
+    bool moved[MAX_LED_CHANNELS];
+    size_t offset = 0;
+    bool changed = false;
+
+    m_arena_dirty = false;
+
+    for (size_t i = 0; i < m_n_led_threads; ++i) {
+        auto const t = m_led_threads[i];
+
+        /* channels that aren't started yet get their share when they are */
+        size_t const want = t->started ? t->render_config.n_leds : 0;
+        auto const n = std::min(want, t->arena_fit(LED_ARENA_SIZE - offset));
+        auto len = t->arena_bytes(n);
+
+        if (offset + len > LED_ARENA_SIZE) {
+            len = 0; /* not even the bus resets fit */
+        }
+
+        if (n < want) {
+            NRF_LOG_WARNING("channel %u: the LED arena only has room for %u of %u LEDs", i, n, want);
+        }
+
+        to[i] = arena_slice { .ptr = arena_base() + offset, .len = len, .n_leds = n };
+        offset += len;
+        moved[i] = !is_same_slice(to[i], t->slice);
+        changed = changed || moved[i];
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    /* Frames in the arena may still be being sent. A channel that shrinks
+     * also turns off the LEDs that it won't reach anymore, while it can. */
+    for (size_t i = 0; i < m_n_led_threads; ++i) {
+        auto const t = m_led_threads[i];
+
+        if (!t->started || !t->arena_frames || !moved[i]) {
+            continue;
+        }
+
+        t->wait_until_sent();
+
+        if (to[i].n_leds < t->slice.n_leds) {
+            t->blank_sent_frame(t->slice.n_leds);
+            ret = t->set_frame(t->frames.sent_frame());
+            APP_ERROR_CHECK(ret);
+            ret = t->tp->send();
+            APP_ERROR_CHECK(ret);
+            t->wait_until_sent();
+        }
+    }
+
+    for (size_t i = 0; i < m_n_led_threads; ++i) {
+        auto const t = m_led_threads[i];
+        from_ptrs[i] = t->slice.ptr;
+        to_ptrs[i] = to[i].ptr;
+        keep[i] = t->pixel_bytes(std::min(to[i].n_leds, t->slice.n_leds));
+    }
+
+    /* BLE writes into the pixels must not land in the middle of the move */
+    CRITICAL_REGION_ENTER();
+        arena_move(from_ptrs, to_ptrs, keep, m_n_led_threads);
+
+        for (size_t i = 0; i < m_n_led_threads; ++i) {
+            auto const t = m_led_threads[i];
+            if (!moved[i]) {
+                continue;
+            }
+
+            memset(&to_ptrs[i][keep[i]], 0, t->pixel_bytes(to[i].n_leds) - keep[i]);
+            t->place(to[i]);
+        }
+    CRITICAL_REGION_EXIT();
+
+    /* frames that were rendered before the move are gone */
+    for (size_t i = 0; i < m_n_led_threads; ++i) {
+        auto const t = m_led_threads[i];
+        if (!t->started || !moved[i]) {
+            continue;
+        }
+
+        t->inputs_changed = true;
+
+        if (t->arena_frames) {
+            t->frames.discard();
+            t->blank_sent_frame(to[i].n_leds);
+            t->has_sent = false;
+        }
+    }
 }
 
 void led::resume_all()
 {
     for (size_t i = 0; i < m_n_led_threads; ++i) {
-        vTaskResume(m_led_threads[i]);
+        m_led_threads[i]->enable();
     }
 }
 
-static void led_task_func(void *context)
+ret_code_t led::pipeline_snapshot(size_t channel, pipeline_stats *out, bool clear)
 {
-    thread *task = (thread*)context;
-    assert(task != nullptr);
-    task->task_func();    
+#if LED_PIPELINE_STATS
+    if (channel >= m_n_led_threads) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    /* airtime is recorded from the send completion interrupt */
+    auto const t = m_led_threads[channel];
+
+    CRITICAL_REGION_ENTER();
+    *out = t->probe.stats;
+    if (clear) {
+        t->probe.stats = pipeline_stats {};
+    }
+    CRITICAL_REGION_EXIT();
+
+    out->frames = t->counters();
+
+    return NRF_SUCCESS;
+#else
+    unused(channel);
+    unused(out);
+    unused(clear);
+    return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/* Serves every LED channel, earliest deadline first. A channel is started
+ * the first time the scheduler sees that it is enabled. */
+static void scheduler_func(void *context)
+{
+    unused(context);
+
+    while (1) {
+        auto const now = time::ticks();
+        thread *next = nullptr;
+        TickType_t next_due = 0;
+
+        for (size_t i = 0; i < m_n_led_threads; ++i) {
+            auto const t = m_led_threads[i];
+
+            if (!t->is_enabled()) {
+                continue;
+            } else if (!t->is_started()) {
+                t->start();
+            }
+
+            auto const due = t->next_deadline(now);
+            if (!next || is_before(due, next_due)) {
+                next = t;
+                next_due = due;
+            }
+        }
+
+        if (!next) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        /* a channel that is enabled in the meantime wakes the scheduler early */
+        auto const wait = (int32_t)(next_due - now);
+        if (wait > 0) {
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+
+        /* channels that were started or resized get their share of the arena first */
+        if (m_arena_dirty) {
+            thread::repartition_arena();
+            continue;
+        }
+
+        next->run_frame(now);
+    }
 }
@@ -7,14 +7,40 @@
 using namespace spi;
 using send_complete_t = led::transport::send_complete_t;
 
+/* 16MHz / 6. This is not one of the documented presets, but the FREQUENCY
+ * register scales linearly between them (0x02000000 is 125kHz, 0x80000000 is
+ * 8MHz). Rounded the same way as the UARTE's BAUDRATE register. */
+#define SPIM_FREQ_2M67 ((nrf_spim_frequency_t)0x2AAAB000UL)
+
 struct tx_buffer { uint8_t *buffer; size_t length; };
 
+/* Streams and segment lists are sent as a chain of transfers. The PPI
+ * channel triggers START on every END, and TXD.PTR is double-buffered, so
+ * the next part is already loaded when the one before it finishes. The END
+ * interrupt then has one part's worth of airtime to load the part after it.
+ * For a stream, that includes refilling the chunk that just finished. */
+struct tx_chain {
+    led::stream *source;
+    led::segment const *segments;
+    size_t n_segments;
+    size_t seg_idx;
+    uint8_t next;
+    bool queued;
+    bool has_ppi;
+    nrf_ppi_channel_t ppi;
+};
+
 static void spim_evt_handler(nrfx_spim_evt_t const *event, void *context);
 static nrfx_spim_t *spim_inst(id id);
 static send_complete_t callback(id id, send_complete_t cb);
 static tx_buffer *queued_buffer(id id, tx_buffer *buffer);
+static tx_chain *queued_chain(id id);
+static ret_code_t chain_init(id id);
+static size_t chain_next(tx_chain *ch, uint8_t idx, uint8_t const **data);
+static bool chain_part_done(id id);
 static bool ready(id id, bool *v);
 static void *cb_context[MAX_SPIM_INST] = {};
+static uint32_t m_byte_rate[MAX_SPIM_INST] = {};
 
 transport::transport(id id): led::transport(),
     inst_id(id)
@@ -32,10 +58,16 @@ ret_code_t transport::init(spi_init const &init)
     config.mode = NRF_SPIM_MODE_0;
 
     switch (init.frequency) {
+    case FREQ_2M67: config.frequency = SPIM_FREQ_2M67; m_byte_rate[inst_id] = 8000000 / 3 / 8; break;
     // case FREQ_4M: config.frequency = NRF_SPIM_FREQ_4M; break;
-    case FREQ_8M: config.frequency = NRF_SPIM_FREQ_8M; break;
-    // case FREQ_16M: config.frequency = NRF_SPIM_FREQ_16M; break;
-    // case FREQ_32M: config.frequency = NRF_SPIM_FREQ_32M; break;
+    case FREQ_8M: config.frequency = NRF_SPIM_FREQ_8M; m_byte_rate[inst_id] = 8000000 / 8; break;
+#if defined(SPIM_FREQUENCY_FREQUENCY_M32)
+    /* nrfx_spim_init rejects these on instances other than SPIM3 */
+    case FREQ_16M: config.frequency = NRF_SPIM_FREQ_16M; m_byte_rate[inst_id] = 16000000 / 8; break;
+    case FREQ_32M: config.frequency = NRF_SPIM_FREQ_32M; m_byte_rate[inst_id] = 32000000 / 8; break;
+#endif
+    default:
+        return NRF_ERROR_INVALID_PARAM;
     }
 
     ret_code_t ret = nrfx_spim_init(spim_inst(inst_id), &config, spim_evt_handler, (void*)static_cast<uintptr_t>(inst_id));
@@ -73,6 +105,64 @@ ret_code_t transport::set_buffer(uint8_t *buf, size_t length)
         auto bufp = queued_buffer(inst_id, nullptr);
         bufp->buffer = buf;
         bufp->length = length;
+        queued_chain(inst_id)->source = nullptr;
+        queued_chain(inst_id)->segments = nullptr;
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t transport::set_stream(led::stream *s)
+{
+    if (!ready(inst_id, nullptr)) {
+        return NRF_ERROR_BUSY;
+    } else if (!s) {
+        return NRF_ERROR_NULL;
+    } else if (!led::stream::keeps_up(m_byte_rate[inst_id])) {
+        /* at 16 and 32MHz, unless the chunks were made larger */
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    ret_code_t ret;
+
+    auto ch = queued_chain(inst_id);
+
+    ret = chain_init(inst_id);
+    VERIFY_SUCCESS(ret);
+
+    CRITICAL_REGION_ENTER();
+        tx_buffer txbuf = { .buffer = nullptr, .length = 0 };
+        queued_buffer(inst_id, &txbuf);
+        ch->source = s;
+        ch->segments = nullptr;
+        ch->queued = false;
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+ret_code_t transport::set_segments(led::segment const *segments, size_t n)
+{
+    if (!ready(inst_id, nullptr)) {
+        return NRF_ERROR_BUSY;
+    } else if (!segments) {
+        return NRF_ERROR_NULL;
+    }
+
+    ret_code_t ret;
+
+    auto ch = queued_chain(inst_id);
+
+    ret = chain_init(inst_id);
+    VERIFY_SUCCESS(ret);
+
+    CRITICAL_REGION_ENTER();
+        tx_buffer txbuf = { .buffer = nullptr, .length = 0 };
+        queued_buffer(inst_id, &txbuf);
+        ch->source = nullptr;
+        ch->segments = segments;
+        ch->n_segments = n;
+        ch->queued = false;
     CRITICAL_REGION_EXIT();
 
     return NRF_SUCCESS;
@@ -87,26 +177,88 @@ ret_code_t transport::send()
     ret_code_t ret = NRF_SUCCESS;
 
     auto spim = spim_inst(inst_id);
+    auto ch = queued_chain(inst_id);
 
     CRITICAL_REGION_ENTER();
         auto bufp = queued_buffer(inst_id, nullptr);
-        if (!bufp->buffer)
+        if (!bufp->buffer && !ch->source && !ch->segments) {
             ret = ERROR_NO_BUFFER;
-        bool set_ready = false;
-        ready(inst_id, &set_ready);
+        } else {
+            bool set_ready = false;
+            ready(inst_id, &set_ready);
+        }
     CRITICAL_REGION_EXIT();
     VERIFY_SUCCESS(ret);
 
+    if (ch->source || ch->segments) {
+        return send_chain();
+    }
+
     nrf_spim_task_trigger(spim->p_reg, NRF_SPIM_TASK_START);
 
     return NRF_SUCCESS;
 }
 
+ret_code_t transport::send_chain()
+{
+    ret_code_t ret;
+
+    auto spim = spim_inst(inst_id);
+    auto ch = queued_chain(inst_id);
+
+    /* the first two parts are prepared here, in thread context */
+    if (ch->source) {
+        ch->source->rewind();
+    }
+    ch->seg_idx = 0;
+
+    uint8_t const *data0 = nullptr;
+    uint8_t const *data1 = nullptr;
+    auto const len0 = chain_next(ch, 0, &data0);
+    auto const len1 = chain_next(ch, 1, &data1);
+
+    if (len0 == 0) {
+        bool set_ready = true;
+        ready(inst_id, &set_ready);
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    nrfx_spim_xfer_desc_t xfer = NRFX_SPIM_XFER_TX(data0, len0);
+
+    ret = nrfx_spim_xfer(spim, &xfer, NRFX_SPIM_FLAG_HOLD_XFER | NRFX_SPIM_FLAG_REPEATED_XFER);
+    VERIFY_SUCCESS(ret);
+
+    ch->next = 1;
+    ch->queued = len1 > 0;
+
+    if (ch->queued) {
+        ret = nrfx_ppi_channel_enable(ch->ppi);
+        VERIFY_SUCCESS(ret);
+    }
+
+    nrf_spim_event_clear(spim->p_reg, NRF_SPIM_EVENT_STARTED);
+    nrf_spim_task_trigger(spim->p_reg, NRF_SPIM_TASK_START);
+
+    if (ch->queued) {
+        /* TXD.PTR can take the next part as soon as the first has started */
+        while (!nrf_spim_event_check(spim->p_reg, NRF_SPIM_EVENT_STARTED)) {}
+        nrf_spim_event_clear(spim->p_reg, NRF_SPIM_EVENT_STARTED);
+        nrf_spim_tx_buffer_set(spim->p_reg, data1, len1);
+    }
+
+    return NRF_SUCCESS;
+}
+
 bool transport::is_ready()
 {
     return ready(inst_id, nullptr);
 }
 
+uint32_t transport::byte_rate()
+{
+    return m_byte_rate[inst_id];
+}
+
 static void spim_evt_handler(nrfx_spim_evt_t const *event, void *context)
 {
     if (event && event->type == NRFX_SPIM_EVENT_DONE) {
@@ -115,6 +267,11 @@ static void spim_evt_handler(nrfx_spim_evt_t const *event, void *context)
         bool do_release_buffer = false;
         BaseType_t do_context_switch = pdFALSE;
 
+        auto ch = queued_chain(inst_id);
+        if ((ch->source || ch->segments) && !chain_part_done(inst_id)) {
+            return;
+        }
+
         CRITICAL_REGION_ENTER();
             auto completion = callback(inst_id, nullptr);
             auto buffer = queued_buffer(inst_id, nullptr);
@@ -124,6 +281,8 @@ static void spim_evt_handler(nrfx_spim_evt_t const *event, void *context)
         if (do_release_buffer) {
             tx_buffer txbuf = { .buffer = nullptr, .length = 0 };
             queued_buffer(inst_id, &txbuf);
+            ch->source = nullptr;
+            ch->segments = nullptr;
         }
 
         bool set_ready = true;
@@ -132,6 +291,81 @@ static void spim_evt_handler(nrfx_spim_evt_t const *event, void *context)
     }
 }
 
+static ret_code_t chain_init(id id)
+{
+    auto ch = queued_chain(id);
+    auto spim = spim_inst(id);
+
+    if (ch->has_ppi) {
+        return NRF_SUCCESS;
+    }
+
+    ret_code_t ret;
+
+    ret = nrfx_ppi_channel_alloc(&ch->ppi);
+    VERIFY_SUCCESS(ret);
+
+    ret = nrfx_ppi_channel_assign(ch->ppi, nrfx_spim_end_event_get(spim), nrfx_spim_start_task_get(spim));
+    VERIFY_SUCCESS(ret);
+
+    ch->has_ppi = true;
+
+    return NRF_SUCCESS;
+}
+
+/* Get the next part of a chain. `idx` is the stream chunk that is free to be
+ * refilled. Returns 0 when there are no parts left. */
+static size_t chain_next(tx_chain *ch, uint8_t idx, uint8_t const **data)
+{
+    if (ch->source) {
+        *data = ch->source->chunk(idx);
+        return ch->source->fill(idx);
+    }
+
+    /* SPIM can't send an empty transfer, skip those */
+    while (ch->seg_idx < ch->n_segments) {
+        auto const &seg = ch->segments[ch->seg_idx++];
+        if (seg.length > 0) {
+            *data = seg.data;
+            return seg.length;
+        }
+    }
+
+    return 0;
+}
+
+/* Called on every END while a chain is being sent. Returns `true` once the
+ * last part has been sent. */
+static bool chain_part_done(id id)
+{
+    auto ch = queued_chain(id);
+    auto p_reg = spim_inst(id)->p_reg;
+
+    if (!ch->queued) {
+        return true;
+    }
+
+    /* `next` was started by the PPI channel, so the part before it is free.
+     * Wait until TXD.PTR has been latched before replacing it. */
+    while (!nrf_spim_event_check(p_reg, NRF_SPIM_EVENT_STARTED)) {}
+    nrf_spim_event_clear(p_reg, NRF_SPIM_EVENT_STARTED);
+
+    auto const done = ch->next ^ 1;
+    uint8_t const *data = nullptr;
+    auto const len = chain_next(ch, done, &data);
+
+    if (len > 0) {
+        nrf_spim_tx_buffer_set(p_reg, data, len);
+        ch->next = done;
+    } else {
+        /* `next` is the last part */
+        nrfx_ppi_channel_disable(ch->ppi);
+        ch->queued = false;
+    }
+
+    return false;
+}
+
 static nrfx_spim_t *spim_inst(id id)
 {
     static nrfx_spim_t spim_inst[] = {
@@ -180,6 +414,15 @@ static tx_buffer *queued_buffer(id id, tx_buffer *buffer)
     return &tx_buffer_inst[id];
 }
 
+static tx_chain *queued_chain(id id)
+{
+    static tx_chain tx_chain_inst[MAX_SPIM_INST] = {};
+
+    assert(id < MAX_SPIM_INST);
+
+    return &tx_chain_inst[id];
+}
+
 static bool ready(id id, bool *x)
 {
     static bool ready_inst[MAX_SPIM_INST] = {};
@@ -1,24 +1,54 @@
 #define NRF_LOG_MODULE_NAME uarte
 #include "prelude.hh"
 #include "periph/uarte.hh"
+#include "dmx.hh"
 #include "sdk_config.h"
 #include "nrfx_uarte.h"
 #include "nrf_uarte.h"
-#include "stream_buffer.h"
+#include "nrfx_timer.h"
+#include "nrfx_ppi.h"
+#include "queue.h"
 NRF_LOG_MODULE_REGISTER();
 
 using namespace uarte;
 
+static_assert(DMX_RX_BUFFERS >= 2 && DMX_RX_BUFFERS <= 8);
+static_assert(DMX_MAX_FRAME_SIZE % sizeof(uint32_t) == 0);
+
+/* Received frames stay in the buffer the UARTE wrote them to. The buffer
+ * is passed to the packet task, and comes back to `free` when the task
+ * releases it.
+ *
+ * Alternate start code frames go through `frame_queue`. A dimmer frame
+ * waits in `latest` instead, where the next one replaces it, so that the
+ * task never works through stale levels. `frame_queue` then holds an
+ * entry without data in its place.
+ *
+ * With a byte counter, a dimmer frame is handed over as soon as its first
+ * `frame_size` bytes are in RAM, while the rest of it is still being received
+ * into the same buffer. That buffer is `lent`, and is only freed once both
+ * the UARTE and the packet task are done with it. */
 struct uarte_context {
     uarte::id inst_id;
-    MessageBufferHandle_t frame_buf;
+    QueueHandle_t frame_queue;
     bool is_enabled;
-    uint8_t buffer0[DMX_MAX_FRAME_SIZE] __attribute__((aligned(sizeof(uint32_t))));
+    int8_t receiving;   /* buffer being received into, or -1 */
+    int8_t next;        /* buffer the UARTE moves on to when `receiving` is full, or -1 */
+    int8_t latest;      /* buffer of the latest dimmer frame that wasn't taken yet, or -1 */
+    bool latest_queued; /* whether `frame_queue` has an entry for `latest` */
+    size_t latest_length;
+    uint8_t alt_queued; /* alternate start code frames in `frame_queue` */
+    int8_t lent;        /* `receiving`, if it was handed over before it was complete, or -1 */
+    bool lent_returned; /* whether the packet task is done with `lent` */
+    nrfx_timer_t const *counter;    /* counts RXDRDY since `receiving` was started, or nullptr */
+    nrf_ppi_channel_t ppi;
+    size_t frame_size;  /* see `transport::set_frame_size`, 0 if unset */
+    uint8_t free;       /* bit i is set if `buffers[i]` is owned by neither the UARTE nor the packet task */
+    uint8_t buffers[DMX_RX_BUFFERS][DMX_MAX_FRAME_SIZE] __attribute__((aligned(sizeof(uint32_t))));
 
     inline transport get_transport() { return transport(inst_id); }
 };
 
-
 static uarte_context m_uarte_context[MAX_UARTE_INST] __attribute__((aligned(sizeof(uint32_t)))) = {};
 static nrfx_uarte_t m_uarte_inst[] = {
 #if NRFX_UARTE0_ENABLED
@@ -36,15 +66,27 @@ static nrfx_uarte_t m_uarte_inst[] = {
 };
 
 static void uarte_evt_handler(nrfx_uarte_event_t const *event, void *context);
+static ret_code_t arm_rx(uarte_context *ctxt);
+static ret_code_t counter_init(uarte_context *ctxt, uint8_t irq_priority);
 
 ret_code_t uarte::transport::init(uarte_init const &init)
 {
     ret_code_t ret;
 
     m_uarte_context[inst_id].is_enabled = false;
+    m_uarte_context[inst_id].receiving = -1;
+    m_uarte_context[inst_id].next = -1;
+    m_uarte_context[inst_id].latest = -1;
+    m_uarte_context[inst_id].latest_queued = false;
+    m_uarte_context[inst_id].alt_queued = 0;
+    m_uarte_context[inst_id].lent = -1;
+    m_uarte_context[inst_id].counter = init.byte_counter;
+    m_uarte_context[inst_id].frame_size = 0;
+    m_uarte_context[inst_id].free = (1u << DMX_RX_BUFFERS) - 1;
 
-    m_uarte_context[inst_id].frame_buf = xMessageBufferCreate(DMX_MAX_QUEUED_FRAMES * DMX_MAX_FRAME_SIZE);
-    if (m_uarte_context[inst_id].frame_buf == nullptr)
+    /* the alternate start code frames, and one entry for `latest` */
+    m_uarte_context[inst_id].frame_queue = xQueueCreate(DMX_MAX_QUEUED_ALT_FRAMES + 1, sizeof(dmx::rx_frame));
+    if (m_uarte_context[inst_id].frame_queue == nullptr)
         return NRF_ERROR_NO_MEM;
 
     auto inst = &m_uarte_inst[inst_id];
@@ -64,27 +106,276 @@ ret_code_t uarte::transport::init(uarte_init const &init)
     ret = nrfx_uarte_init(inst, &config, uarte_evt_handler);
     VERIFY_SUCCESS(ret);
 
+    if (init.byte_counter) {
+        ret = counter_init(&m_uarte_context[inst_id], config.interrupt_priority);
+        VERIFY_SUCCESS(ret);
+    }
+
     return ret;
 }
 
-MessageBufferHandle_t uarte::transport::frame_buf()
+ret_code_t uarte::transport::receive(dmx::rx_frame *frame, TickType_t max_delay)
 {
-    return m_uarte_context[inst_id].frame_buf;
+    auto ctxt = &m_uarte_context[inst_id];
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+
+    for (;;) {
+        if (!xQueueReceive(ctxt->frame_queue, frame, max_delay)) {
+            return NRF_ERROR_TIMEOUT;
+        }
+
+        if (frame->data) {
+            CRITICAL_REGION_ENTER();
+                ctxt->alt_queued -= 1;
+            CRITICAL_REGION_EXIT();
+            return NRF_SUCCESS;
+        }
+
+        int8_t idx;
+        CRITICAL_REGION_ENTER();
+            idx = ctxt->latest;
+            frame->length = ctxt->latest_length;
+            ctxt->latest = -1;
+            ctxt->latest_queued = false;
+        CRITICAL_REGION_EXIT();
+
+        if (idx >= 0) {
+            frame->data = ctxt->buffers[idx];
+            return NRF_SUCCESS;
+        }
+
+        /* taken back by `arm_rx` to keep receiving, the frame being
+         * received into it queues a new entry */
+        if (xTaskCheckForTimeOut(&timeout, &max_delay)) {
+            return NRF_ERROR_TIMEOUT;
+        }
+    }
 }
 
-ret_code_t uarte::transport::enable()
+static size_t buffer_index(uarte_context *ctxt, uint8_t const *ptr)
+{
+    auto const idx = (size_t)(ptr - ctxt->buffers[0]) / DMX_MAX_FRAME_SIZE;
+    assert(idx < DMX_RX_BUFFERS);
+    return idx;
+}
+
+/* Called when the packet task, or the mailbox, is done with a buffer. */
+static void give_back(uarte_context *ctxt, int8_t idx)
+{
+    if (idx == ctxt->lent) {
+        /* freed once it is complete */
+        ctxt->lent_returned = true;
+    } else {
+        ctxt->free |= 1u << idx;
+    }
+}
+
+/* Called when the UARTE is done with a buffer. Returns false if the frame
+ * in it was handed over already. */
+static bool end_rx(uarte_context *ctxt, int8_t idx)
 {
-    ret_code_t ret = nrfx_uarte_rx(&m_uarte_inst[inst_id], m_uarte_context[inst_id].buffer0, sizeof(m_uarte_context[inst_id].buffer0));
-    if (ret == NRF_SUCCESS) {
-        m_uarte_context[inst_id].is_enabled = true;
+    if (idx != ctxt->lent) {
+        return true;
     }
+
+    if (ctxt->lent_returned) {
+        ctxt->free |= 1u << idx;
+    }
+    ctxt->lent = -1;
+    return false;
+}
+
+void uarte::transport::release(dmx::rx_frame const &frame)
+{
+    auto ctxt = &m_uarte_context[inst_id];
+    auto const idx = buffer_index(ctxt, frame.data);
+
+    CRITICAL_REGION_ENTER();
+        give_back(ctxt, idx);
+        /* the UARTE may have run out of buffers while the task held them */
+        if (ctxt->is_enabled) {
+            arm_rx(ctxt);
+        }
+    CRITICAL_REGION_EXIT();
+}
+
+ret_code_t uarte::transport::enable()
+{
+    ret_code_t ret;
+    auto ctxt = &m_uarte_context[inst_id];
+
+    CRITICAL_REGION_ENTER();
+        ret = arm_rx(ctxt);
+        if (ret == NRF_SUCCESS) {
+            ctxt->is_enabled = true;
+        }
+    CRITICAL_REGION_EXIT();
+
     return ret;
 }
 
 ret_code_t uarte::transport::disable()
 {
-    m_uarte_context[inst_id].is_enabled = false;
+    auto ctxt = &m_uarte_context[inst_id];
+
+    ctxt->is_enabled = false;
     nrfx_uarte_rx_abort(&m_uarte_inst[inst_id]);
+
+    CRITICAL_REGION_ENTER();
+        if (ctxt->receiving >= 0 && end_rx(ctxt, ctxt->receiving)) {
+            ctxt->free |= 1u << ctxt->receiving;
+        }
+        if (ctxt->next >= 0) {
+            ctxt->free |= 1u << ctxt->next;
+        }
+        ctxt->receiving = -1;
+        ctxt->next = -1;
+    CRITICAL_REGION_EXIT();
+
+    return NRF_SUCCESS;
+}
+
+void uarte::transport::set_frame_size(size_t n_bytes)
+{
+    auto ctxt = &m_uarte_context[inst_id];
+    if (!ctxt->counter) {
+        return;
+    }
+
+    n_bytes = std::min(n_bytes, (size_t)DMX_MAX_FRAME_SIZE);
+
+    /* RXDRDY comes before EasyDMA has written the byte to RAM, so the
+     * frame is handed over at the byte after its last one, which is only
+     * signalled once that one is in. Frames that end right after it are
+     * handed over at the break instead. */
+    CRITICAL_REGION_ENTER();
+        ctxt->frame_size = n_bytes;
+        if (n_bytes) {
+            nrfx_timer_compare(ctxt->counter, NRF_TIMER_CC_CHANNEL0, n_bytes + 1, true);
+        } else {
+            nrfx_timer_compare_int_disable(ctxt->counter, NRF_TIMER_CC_CHANNEL0);
+        }
+    CRITICAL_REGION_EXIT();
+}
+
+static int8_t take_free(uarte_context *ctxt)
+{
+    /* a newer dimmer frame is on its way, so the latest one can go */
+    if (!ctxt->free && ctxt->latest >= 0 && ctxt->latest != ctxt->lent) {
+        ctxt->free |= 1u << ctxt->latest;
+        ctxt->latest = -1;
+    }
+
+    if (!ctxt->free) {
+        return -1;
+    }
+
+    auto const idx = __builtin_ctz(ctxt->free);
+    ctxt->free &= ~(1u << idx);
+    return idx;
+}
+
+/* Hand a received frame to the packet task. Called from the UARTE interrupt. */
+static void queue_frame(uarte_context *ctxt, dmx::rx_frame const &frame, BaseType_t *do_yield)
+{
+    auto const idx = buffer_index(ctxt, frame.data);
+
+    if (frame.length > 0 && frame.data[0] == (uint8_t)dmx::start_code::dimmer) {
+        if (ctxt->latest >= 0) {
+            give_back(ctxt, ctxt->latest);
+        }
+        ctxt->latest = idx;
+        ctxt->latest_length = frame.length;
+
+        auto const placeholder = dmx::rx_frame { nullptr, 0 };
+        if (!ctxt->latest_queued && xQueueSendFromISR(ctxt->frame_queue, &placeholder, do_yield)) {
+            ctxt->latest_queued = true;
+        }
+        return;
+    }
+
+    /* leaves room for the placeholder */
+    if (ctxt->alt_queued < DMX_MAX_QUEUED_ALT_FRAMES && xQueueSendFromISR(ctxt->frame_queue, &frame, do_yield)) {
+        ctxt->alt_queued += 1;
+    } else {
+        NRF_LOG_WARNING("Alternate start code frame dropped (0x%02x)", frame.data[0]);
+        give_back(ctxt, idx);
+    }
+}
+
+/* Bytes received into `receiving`. The break itself may be one of them, as
+ * a trailing 0. Called from the UARTE interrupt. */
+static size_t received_bytes(uarte_context *ctxt)
+{
+    if (!ctxt->counter) {
+        return 0;
+    }
+
+    return std::min((size_t)nrfx_timer_capture(ctxt->counter, NRF_TIMER_CC_CHANNEL1), (size_t)DMX_MAX_FRAME_SIZE);
+}
+
+/* Count the bytes of a new reception from 0. The compare event of the
+ * previous one may be latched still, with its interrupt pending behind the
+ * UARTE one, and would lend the new buffer before anything is in it. */
+static void restart_count(uarte_context *ctxt)
+{
+    nrfx_timer_clear(ctxt->counter);
+    nrf_timer_event_clear(ctxt->counter->p_reg, NRF_TIMER_EVENT_COMPARE0);
+    NVIC_ClearPendingIRQ(nrfx_get_irq_number(ctxt->counter->p_reg));
+}
+
+/* RXD.PTR may only be changed for the next reception once the current one
+ * has latched it, which takes a few cycles after STARTRX. */
+static void wait_rx_started(nrfx_uarte_t const *inst)
+{
+    for (size_t i = 0; i < 1000 && !nrf_uarte_event_check(inst->p_reg, NRF_UARTE_EVENT_RXSTARTED); ++i) {
+    }
+    nrf_uarte_event_clear(inst->p_reg, NRF_UARTE_EVENT_RXSTARTED);
+}
+
+/* Keep the UARTE receiving, with a buffer queued behind the current one so
+ * that it moves on to it in hardware, without waiting for the interrupt.
+ * Called from the UARTE interrupt, or with it masked. */
+static ret_code_t arm_rx(uarte_context *ctxt)
+{
+    ret_code_t ret;
+    auto inst = &m_uarte_inst[ctxt->inst_id];
+
+    if (ctxt->receiving < 0) {
+        auto const idx = take_free(ctxt);
+        if (idx < 0) {
+            return NRF_ERROR_NO_MEM;
+        }
+
+        if (ctxt->counter) {
+            restart_count(ctxt);
+        }
+        nrf_uarte_event_clear(inst->p_reg, NRF_UARTE_EVENT_RXSTARTED);
+        ret = nrfx_uarte_rx(inst, ctxt->buffers[idx], DMX_MAX_FRAME_SIZE);
+        if (ret != NRF_SUCCESS) {
+            ctxt->free |= 1u << idx;
+            return ret;
+        }
+        ctxt->receiving = idx;
+    }
+
+    if (ctxt->next < 0) {
+        auto const idx = take_free(ctxt);
+        if (idx < 0) {
+            /* set up by `release` */
+            return NRF_SUCCESS;
+        }
+
+        wait_rx_started(inst);
+        ret = nrfx_uarte_rx(inst, ctxt->buffers[idx], DMX_MAX_FRAME_SIZE);
+        if (ret != NRF_SUCCESS) {
+            ctxt->free |= 1u << idx;
+            return NRF_SUCCESS;
+        }
+        ctxt->next = idx;
+    }
+
     return NRF_SUCCESS;
 }
 
@@ -100,22 +391,111 @@ static void uarte_evt_handler(nrfx_uarte_event_t const *event, void *context)
     }
 
     auto ctxt = ((uarte_context*)context);
-    auto tx = ctxt->get_transport();
     BaseType_t do_yield = pdFALSE;
 
     if (event->type == NRFX_UARTE_EVT_RX_DONE) {
-        auto ptr = event->data.rxtx.p_data;
-        auto length = event->data.rxtx.bytes;
+        auto const frame = dmx::rx_frame { event->data.rxtx.p_data, event->data.rxtx.bytes };
+        auto const idx = buffer_index(ctxt, frame.data);
+
+        /* the UARTE has already moved on to `next`, if there was one */
+        ctxt->receiving = ctxt->next;
+        ctxt->next = -1;
+        if (ctxt->counter) {
+            restart_count(ctxt);
+        }
+
+        if (!end_rx(ctxt, idx)) {
+            /* handed over already */
+        } else if (ctxt->is_enabled) {
+            queue_frame(ctxt, frame, &do_yield);
+        } else {
+            ctxt->free |= 1u << idx;
+        }
+
         if (ctxt->is_enabled) {
-            xMessageBufferSendFromISR(tx.frame_buf(), ptr, length, &do_yield);
-            nrfx_uarte_rx(&m_uarte_inst[ctxt->inst_id], ctxt->buffer0, sizeof(ctxt->buffer0));
+            arm_rx(ctxt);
         }
-        
+
     } else if (event->type == NRFX_UARTE_EVT_ERROR && (event->data.error.error_mask & NRF_UARTE_ERROR_BREAK_MASK)) {
+        /* The break ends the frame. The driver has dropped both buffers,
+         * so start over. */
+        nrf_uarte_shorts_disable(m_uarte_inst[ctxt->inst_id].p_reg, NRF_UARTE_SHORT_ENDRX_STARTRX);
+        if (ctxt->receiving >= 0) {
+            auto const idx = ctxt->receiving;
+            auto const length = received_bytes(ctxt);
+
+            if (!end_rx(ctxt, idx)) {
+                /* handed over already */
+            } else if (ctxt->is_enabled && length > 0) {
+                queue_frame(ctxt, dmx::rx_frame { ctxt->buffers[idx], length }, &do_yield);
+            } else {
+                ctxt->free |= 1u << idx;
+            }
+        }
+        if (ctxt->next >= 0) {
+            ctxt->free |= 1u << ctxt->next;
+        }
+        ctxt->receiving = -1;
+        ctxt->next = -1;
+
         if (ctxt->is_enabled) {
-            nrfx_uarte_rx(&m_uarte_inst[ctxt->inst_id], ctxt->buffer0, sizeof(ctxt->buffer0));
+            arm_rx(ctxt);
+        }
+    }
+
+    portYIELD_FROM_ISR(do_yield);
+}
+
+/* The byte after the first `frame_size` ones was received */
+static void counter_evt_handler(nrf_timer_event_t event, void *context)
+{
+    auto ctxt = ((uarte_context*)context);
+    BaseType_t do_yield = pdFALSE;
+
+    if (event == NRF_TIMER_EVENT_COMPARE0 && ctxt->is_enabled && ctxt->receiving >= 0 && ctxt->lent < 0) {
+        auto const data = ctxt->buffers[ctxt->receiving];
+        /* of `receiving`, and not of the reception before it */
+        auto const count = nrfx_timer_capture(ctxt->counter, NRF_TIMER_CC_CHANNEL1);
+
+        /* frames with other start codes are only complete at the break */
+        if (count >= ctxt->frame_size + 1 && data[0] == (uint8_t)dmx::start_code::dimmer) {
+            ctxt->lent = ctxt->receiving;
+            ctxt->lent_returned = false;
+            queue_frame(ctxt, dmx::rx_frame { data, ctxt->frame_size }, &do_yield);
         }
     }
 
     portYIELD_FROM_ISR(do_yield);
 }
+
+/* Count RXDRDY events in hardware. The timer interrupt has the priority of
+ * the UARTE one, so that neither handler preempts the other. */
+static ret_code_t counter_init(uarte_context *ctxt, uint8_t irq_priority)
+{
+    ret_code_t ret;
+    auto inst = &m_uarte_inst[ctxt->inst_id];
+
+    nrfx_timer_config_t config = NRFX_TIMER_DEFAULT_CONFIG;
+    config.mode = NRF_TIMER_MODE_COUNTER;
+    config.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    config.interrupt_priority = irq_priority;
+    config.p_context = ctxt;
+
+    ret = nrfx_timer_init(ctxt->counter, &config, counter_evt_handler);
+    VERIFY_SUCCESS(ret);
+
+    ret = nrfx_ppi_channel_alloc(&ctxt->ppi);
+    VERIFY_SUCCESS(ret);
+
+    ret = nrfx_ppi_channel_assign(ctxt->ppi,
+        nrf_uarte_event_address_get(inst->p_reg, NRF_UARTE_EVENT_RXDRDY),
+        nrfx_timer_task_address_get(ctxt->counter, NRF_TIMER_TASK_COUNT));
+    VERIFY_SUCCESS(ret);
+
+    ret = nrfx_ppi_channel_enable(ctxt->ppi);
+    VERIFY_SUCCESS(ret);
+
+    nrfx_timer_enable(ctxt->counter);
+
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/* APA102 frames: the start frame, a header byte per LED, and an end frame long enough for the strip */
+#include "periph/spi.hh"
+#include "test.hh"
+#include <vector>
+
+template<uint8_t Brightness>
+static void check_frames()
+{
+    using transcoder = spi::transcode_apa102<Brightness>;
+    constexpr size_t reset = transcoder::bytes_per_reset;
+    constexpr size_t max_leds = LED_APA102_MAX_LEDS;
+
+    std::vector<uint8_t> frame(2 * reset + max_leds * transcoder::bytes_per_led);
+    buffer buf(frame.data(), frame.size());
+    transcoder encoder(buf);
+    led::transcode *t = &encoder;
+
+    check(t->header_size() == 0 && t->header() == nullptr, "brightness %u: header", Brightness);
+
+    for (size_t n = 0; n <= max_leds; ++n) {
+        t->clear();
+        check(t->write_frame_start() == NRF_SUCCESS, "%zu LEDs: frame start", n);
+        for (size_t i = 0; i < n; ++i) {
+            auto value = color::rgb(i, i * 3, i * 7);
+            check(t->write(value) == NRF_SUCCESS, "%zu LEDs: LED %zu", n, i);
+        }
+        check(t->write_bus_reset() == NRF_SUCCESS, "%zu LEDs: end frame", n);
+        check(t->len() == 2 * reset + n * 4, "%zu LEDs: %zu bytes", n, t->len());
+
+        auto const p = t->ptr();
+
+        /* at least 32 zero bits before the first LED */
+        static_assert(reset >= spi::apa102_start_frame && spi::apa102_start_frame * 8 >= 32);
+        for (size_t i = 0; i < reset; ++i) {
+            check(p[i] == 0, "%zu LEDs: start frame byte %zu", n, i);
+        }
+
+        /* 3 set bits and the brightness, then blue, green and red */
+        for (size_t i = 0; i < n; ++i) {
+            auto const led = &p[reset + 4 * i];
+            check(led[0] == (0xe0 | Brightness) && led[1] == (uint8_t)(i * 7) && led[2] == (uint8_t)(i * 3) && led[3] == (uint8_t)i,
+                "%zu LEDs: LED %zu is %02x %02x %02x %02x", n, i, led[0], led[1], led[2], led[3]);
+        }
+
+        /* the SK9822's 32 bits, and a clock edge for every 2 LEDs the data passes through */
+        auto const end = &p[reset + 4 * n];
+        auto const end_bytes = spi::apa102_end_frame(n);
+        check(end_bytes <= reset && end_bytes * 8 >= 32 + (n + 1) / 2, "%zu LEDs: end frame of %zu bytes", n, end_bytes);
+        for (size_t i = 0; i < reset; ++i) {
+            check(end[i] == 0, "%zu LEDs: end frame byte %zu", n, i);
+        }
+    }
+
+    printf("apa102: ok, brightness %u, up to %zu LEDs, %zu bytes for each bus reset\n", Brightness, max_leds, reset);
+}
+
+int main()
+{
+    check_frames<31>();
+    check_frames<7>();
+    return 0;
+}
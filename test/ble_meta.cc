@@ -0,0 +1,184 @@
+/* The meta service's pipeline stats characteristic, on a model of the SoftDevice's GATT server */
+#include "ble/meta.hh"
+#include "meta.hh"
+#include "test.hh"
+#include <vector>
+
+namespace gatts {
+    /* one attribute value, where the SoftDevice keeps it */
+    struct attribute {
+        uint8_t *user;              /* BLE_GATTS_VLOC_USER, or nullptr */
+        std::vector<uint8_t> stack; /* BLE_GATTS_VLOC_STACK */
+        uint16_t len;
+        uint16_t max_len;
+
+        uint8_t *value()
+        {
+            return user ? user : stack.data();
+        }
+    };
+
+    static std::vector<attribute> attributes(1);    /* handle 0 is invalid */
+
+    /* a client writes `data`, and the application gets the write event */
+    static void client_write(uint16_t handle, std::vector<uint8_t> const &data)
+    {
+        auto &attr = attributes.at(handle);
+        check(data.size() <= attr.max_len, "write of %zu bytes to handle %u", data.size(), handle);
+        memcpy(attr.value(), data.data(), data.size());
+        attr.len = data.size();
+
+        std::vector<uint8_t> evt_buf(sizeof(ble_evt_t) + data.size());
+        auto evt = (ble_evt_t*)evt_buf.data();
+        evt->header.evt_id = BLE_GATTS_EVT_WRITE;
+        evt->evt.gatts_evt.params.write.handle = handle;
+        evt->evt.gatts_evt.params.write.len = data.size();
+        memcpy(evt->evt.gatts_evt.params.write.data, data.data(), data.size());
+
+        for (size_t i = 0; i < nrf_sdh_ble_n_observers; ++i) {
+            nrf_sdh_ble_observers[i]->handler(evt, nrf_sdh_ble_observers[i]->p_context);
+        }
+    }
+
+    static std::vector<uint8_t> client_read(uint16_t handle)
+    {
+        auto &attr = attributes.at(handle);
+        return std::vector<uint8_t>(attr.value(), attr.value() + attr.len);
+    }
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle)
+{
+    *p_handle = gatts::attributes.size();
+    gatts::attributes.push_back({});
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md, ble_gatts_attr_t const *p_attr_char_value, ble_gatts_char_handles_t *p_handles)
+{
+    auto const &md = *p_attr_char_value->p_attr_md;
+    check(md.vloc == BLE_GATTS_VLOC_STACK || p_attr_char_value->p_value != nullptr, "user memory without a buffer");
+
+    gatts::attribute attr = {};
+    attr.max_len = p_attr_char_value->max_len;
+    attr.len = p_attr_char_value->init_len;
+    if (md.vloc == BLE_GATTS_VLOC_USER) {
+        attr.user = p_attr_char_value->p_value;
+    } else {
+        attr.stack.resize(attr.max_len);
+    }
+
+    *p_handles = {};
+    p_handles->value_handle = gatts::attributes.size();
+    gatts::attributes.push_back(attr);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value)
+{
+    auto &attr = gatts::attributes.at(handle);
+    if (p_value->offset + p_value->len > attr.max_len) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    if (p_value->p_value) {
+        memcpy(attr.value() + p_value->offset, p_value->p_value, p_value->len);
+    }
+    attr.len = p_value->offset + p_value->len;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params)
+{
+    return NRF_ERROR_INVALID_STATE;
+}
+
+uint32_t sd_nvic_SystemReset(void)
+{
+    return NRF_SUCCESS;
+}
+
+uint16_t ble::conn_handle()
+{
+    return BLE_CONN_HANDLE_INVALID;
+}
+
+void ble::disconnect(uint16_t conn_handle, ble::disconnect_reason reason)
+{}
+
+uint8_t ble::uuid_type()
+{
+    return 2;
+}
+
+size_t ble::max_att_data_len()
+{
+    return 244;
+}
+
+meta::rdm_id_t meta::device_rdm_uid()
+{
+    return meta::rdm_id_t {};
+}
+
+/* two LED channels, whose stats say which channel and how often they were cleared */
+static uint32_t m_cleared[2];
+
+ret_code_t led::pipeline_snapshot(size_t channel, pipeline_stats *out, bool clear)
+{
+    if (channel >= 2) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    *out = pipeline_stats {};
+    out->late = 100 + channel;
+    out->frames.sent = m_cleared[channel];
+    m_cleared[channel] += clear;
+    return NRF_SUCCESS;
+}
+
+int main()
+{
+    static meta::service service;
+    check(service.init() == NRF_SUCCESS, "init");
+
+    /* the pipeline characteristic is the one that takes up to sizeof(pipeline_stats) */
+    uint16_t handle = BLE_GATT_HANDLE_INVALID;
+    for (size_t i = 0; i < gatts::attributes.size(); ++i) {
+        if (gatts::attributes[i].max_len == sizeof(led::pipeline_stats)) {
+            handle = i;
+        }
+    }
+    check(handle != BLE_GATT_HANDLE_INVALID, "no pipeline stats characteristic");
+
+    auto const read_stats = [&](char const *what) {
+        auto const bytes = gatts::client_read(handle);
+        check(bytes.size() == sizeof(led::pipeline_stats), "%s: read %zu bytes, %zu expected", what, bytes.size(), sizeof(led::pipeline_stats));
+        led::pipeline_stats stats;
+        memcpy(&stats, bytes.data(), sizeof(stats));
+        return stats;
+    };
+
+    gatts::client_write(handle, { 1 });
+    auto stats = read_stats("channel 1");
+    check(stats.late == 101, "channel 1: late %u", stats.late);
+
+    gatts::client_write(handle, { 0, 0x01 });
+    stats = read_stats("channel 0, cleared");
+    check(stats.late == 100 && stats.frames.sent == 0, "channel 0: late %u, sent %u", stats.late, stats.frames.sent);
+
+    gatts::client_write(handle, { 0 });
+    stats = read_stats("channel 0 again");
+    check(stats.frames.sent == 1, "channel 0 was not cleared");
+
+    /* no such channel: zeros, still the whole struct */
+    gatts::client_write(handle, { 7 });
+    stats = read_stats("channel 7");
+    check(stats.late == 0, "channel 7: late %u", stats.late);
+
+    /* malformed requests leave the last snapshot as it was written */
+    gatts::client_write(handle, { 0, 1, 2 });
+    check(gatts::client_read(handle).size() == 3, "malformed request");
+
+    printf("ble_meta: ok, reads after writes return all %zu bytes of pipeline stats\n", sizeof(led::pipeline_stats));
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* Every chip descriptor at every frequency that drives it, decoded back from the SPI bitstream */
+#include "periph/spi.hh"
+#include "waveform.hh"
+
+template<typename Chip, spi::spi_frequency Frequency, size_t SymbolBits = 0>
+static void check_chip(char const *name)
+{
+    using transcoder = spi::transcode_chip<Chip, Frequency, SymbolBits>;
+    constexpr auto spec = Chip::spec;
+    constexpr auto bit_ps = spi::bit_ps(Frequency);
+    constexpr size_t n_leds = 256;
+
+    /* every value of every channel, with a different value in each of the others */
+    std::vector<color::rgbw> pixels(n_leds);
+    for (size_t i = 0; i < n_leds; ++i) {
+        pixels[i] = color::rgbw(color::rgb(i, i + 85, i + 170), i * 7);
+    }
+
+    std::vector<uint8_t> frame(2 * transcoder::bytes_per_reset + transcoder::encoder::bytes_per_header + n_leds * transcoder::bytes_per_led);
+    buffer buf(frame.data(), frame.size());
+    transcoder encoder(buf);
+    led::transcode *t = &encoder;
+
+    check(t->write_frame_start() == NRF_SUCCESS, "%s: frame start", name);
+    auto out = t->reserve(n_leds);
+    check(out != nullptr, "%s: reserve", name);
+    t->encode_rgbw(pixels.data(), n_leds, out);
+    check(t->write_bus_reset() == NRF_SUCCESS, "%s: bus reset", name);
+    check(t->len() == frame.size(), "%s: %zu bytes, %zu expected", name, t->len(), frame.size());
+
+    /* what the chips should see: the header, then the channels of each LED in their order */
+    std::vector<uint8_t> expect(spec.header, spec.header + spec.header_size);
+    for (auto const &p: pixels) {
+        for (size_t c = 0; c < spec.n_channels; ++c) {
+            expect.push_back(led::channel_value(p, spec.order[c]));
+        }
+    }
+
+    auto const reset = transcoder::bytes_per_reset;
+    for (size_t i = 0; i < reset; ++i) {
+        check(frame[i] == 0 && frame[frame.size() - 1 - i] == 0, "%s: bus reset byte %zu", name, i);
+    }
+    check((uint64_t)reset * 8 * bit_ps >= (uint64_t)spec.reset_ns * 1000, "%s: bus reset of %zu bytes", name, reset);
+
+    test::margins m;
+    auto const bytes = test::decode(spec, &frame[reset], frame.size() - 2 * reset, bit_ps, &m);
+    check(bytes == expect, "%s: decoded %zu bytes, %zu expected", name, bytes.size(), expect.size());
+
+    printf("%s: ok, %zu bytes per LED, margins: high %lldns, period %lldns, low %lldns\n",
+        name, transcoder::bytes_per_led, (long long)m.high, (long long)m.period, (long long)m.low);
+}
+
+int main()
+{
+    using namespace led::chips;
+    using namespace spi;
+
+    /* the same list as the static_asserts at the end of periph/spi.hh */
+    check_chip<ws2812, FREQ_8M>("ws2812 8MHz");
+    check_chip<ws2812, FREQ_8M, 8>("ws2812 8MHz, 8 bit symbols");
+    check_chip<ws2812, FREQ_16M>("ws2812 16MHz");
+    check_chip<ws2812, FREQ_32M>("ws2812 32MHz");
+    check_chip<ws2812, FREQ_2M67>("ws2812 2.67MHz");
+    check_chip<ws2811, FREQ_8M>("ws2811 8MHz");
+    check_chip<ws2811, FREQ_8M, 8>("ws2811 8MHz, 8 bit symbols");
+    check_chip<ws2811, FREQ_16M>("ws2811 16MHz");
+    check_chip<ws2811, FREQ_32M>("ws2811 32MHz");
+    check_chip<sk6812, FREQ_8M>("sk6812 8MHz");
+    check_chip<sk6812, FREQ_8M, 8>("sk6812 8MHz, 8 bit symbols");
+    check_chip<sk6812, FREQ_16M>("sk6812 16MHz");
+    check_chip<sk6812, FREQ_32M>("sk6812 32MHz");
+    check_chip<sk6812_rgbw, FREQ_8M>("sk6812_rgbw 8MHz");
+    check_chip<sk6812_rgbw, FREQ_8M, 8>("sk6812_rgbw 8MHz, 8 bit symbols");
+    check_chip<sk6812_rgbw, FREQ_16M>("sk6812_rgbw 16MHz");
+    check_chip<sk6812_rgbw, FREQ_32M>("sk6812_rgbw 32MHz");
+    check_chip<tm1814<0>, FREQ_8M>("tm1814 8MHz");
+    check_chip<tm1814<42>, FREQ_16M>("tm1814 16MHz");
+    check_chip<tm1814<63>, FREQ_32M>("tm1814 32MHz");
+    return 0;
+}
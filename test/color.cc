@@ -0,0 +1,111 @@
+/* HSV and HSL conversion, against the float formulation it replaced */
+#include "color.hh"
+#include "test.hh"
+
+using namespace color;
+
+static float hue2rgb(float p, float q, float t)
+{
+    if (t < 0) t += 1;
+    if (t > 1) t -= 1;
+    if (t < 1 / 6.0) return p + (q - p) * 6 * t;
+    if (t < 1 / 2.0) return q;
+    if (t < 2 / 3.0) return p + (q - p) * (2 / 3.0 - t) * 6;
+    return p;
+}
+
+static void float_hsv(uint8_t hue, uint8_t sat, uint8_t val, rgb &result, curve curve)
+{
+    if (sat == 0) {
+        result = rgb(val, val, val);
+        return;
+    } else if (val == 0) {
+        result = rgb(0, 0, 0);
+        return;
+    }
+
+    float r, g, b;
+    float const h = hue / 255.0;
+    float s = sat / 255.0;
+    float const v = val / 255.0;
+
+    if (curve == curve::ws2812) {
+        s = 1.0 - (1.0 - s) * (1.0 - s);
+    }
+
+    auto const i = (int)(h * 6);
+    auto const f = h * 6.0 - i;
+    auto const p = v * (1.0 - s);
+    auto const q = v * (1.0 - f * s);
+    auto const t = v * (1.0 - (1.0 - f) * s);
+
+    switch (i % 6) {
+    case 0: r = v, g = t, b = p; break;
+    case 1: r = q, g = v, b = p; break;
+    case 2: r = p, g = v, b = t; break;
+    case 3: r = p, g = q, b = v; break;
+    case 4: r = t, g = p, b = v; break;
+    default: r = v, g = p, b = q; break;
+    }
+
+    result = rgb(r * 255.0, g * 255.0, b * 255.0);
+}
+
+static void float_hsl(uint8_t hue, uint8_t sat, uint8_t lum, rgb &result)
+{
+    float r, g, b;
+    float const h = hue / 255.0, s = sat / 255.0, l = lum / 255.0;
+
+    if (s == 0) {
+        r = g = b = l;
+    } else {
+        auto const q = l < 0.5 ? l * (1 + s) : l + s - l * s;
+        auto const p = 2 * l - q;
+        r = hue2rgb(p, q, h + 1 / 3.0);
+        g = hue2rgb(p, q, h);
+        b = hue2rgb(p, q, h - 1 / 3.0);
+    }
+
+    result = rgb(r * 255, g * 255, b * 255);
+}
+
+static int max_diff(rgb const &a, rgb const &b)
+{
+    return std::max({ abs(a.red - b.red), abs(a.green - b.green), abs(a.blue - b.blue) });
+}
+
+int main()
+{
+    /* every (h, s, v) and (h, s, l) input, within 1 LSB per channel */
+    for (uint32_t i = 0; i < (1 << 24); ++i) {
+        uint8_t const h = i >> 16, s = i >> 8, v = i;
+        rgb got, expect;
+
+        for (auto c: { curve::none, curve::ws2812 }) {
+            hsv(h, s, v).to_rgb(got, c);
+            float_hsv(h, s, v, expect, c);
+            check(max_diff(got, expect) <= 1, "hsv(%u, %u, %u) curve %d: %u %u %u, float %u %u %u",
+                h, s, v, (int)c, got.red, got.green, got.blue, expect.red, expect.green, expect.blue);
+
+            hsl(h, s, v).to_rgb(got, c);
+            float_hsl(h, s, v, expect);
+            check(max_diff(got, expect) <= 1, "hsl(%u, %u, %u) curve %d: %u %u %u, float %u %u %u",
+                h, s, v, (int)c, got.red, got.green, got.blue, expect.red, expect.green, expect.blue);
+        }
+    }
+
+    auto const n = (size_t)1 << 24;
+    auto const int_ns = test::ns_per(n, [](size_t i) {
+        rgb out;
+        hsv(i >> 16, i >> 8, i).to_rgb(out, curve::ws2812);
+        test::sink += out.red + out.green + out.blue;
+    });
+    auto const float_ns = test::ns_per(n, [](size_t i) {
+        rgb out;
+        float_hsv(i >> 16, i >> 8, i, out, curve::ws2812);
+        test::sink += out.red + out.green + out.blue;
+    });
+
+    printf("color: ok, hsv %.2f ns/pixel, float %.2f ns/pixel\n", int_ns, float_ns);
+    return 0;
+}
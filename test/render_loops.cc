@@ -0,0 +1,107 @@
+/* the specialized render loops against one conversion and encode per pixel */
+#include "periph/spi.hh"
+#include "test.hh"
+#include <vector>
+
+using led::color_mode;
+
+/* what a render loop does, one pixel and one virtual call at a time */
+static void per_pixel(led::transcode *t, uint8_t *out, uint8_t const *p, size_t n, color_mode mode, color::correction const *lut, bool extract_white)
+{
+    auto const channels = t->channels();
+
+    for (size_t i = 0; i < n; ++i, p += channels, out += t->led_size()) {
+        color::rgb value;
+        switch (mode) {
+        case color_mode::rgb:
+            value = color::rgb(p[0], p[1], p[2]);
+            break;
+        case color_mode::hsv:
+            color::hsv(p[0], p[1], p[2]).to_rgb(value, color::curve::ws2812);
+            break;
+        case color_mode::hsl:
+            color::hsl(p[0], p[1], p[2]).to_rgb(value, color::curve::ws2812);
+            break;
+        }
+
+        if (channels == 4) {
+            auto with_white = color::rgbw(value, p[3]);
+            if (extract_white) {
+                color::extract_white(with_white);
+            }
+            if (lut) {
+                lut->apply(with_white);
+            }
+            t->encode_rgbw(&with_white, 1, out);
+        } else {
+            if (lut) {
+                lut->apply(value);
+            }
+            t->encode(&value, 1, out);
+        }
+    }
+}
+
+template<typename Transcoder>
+static void check_loops(char const *name, color::correction const &lut)
+{
+    constexpr size_t n = 300;
+
+    Transcoder transcoder;
+    led::transcode *t = &transcoder;
+    auto const channels = t->channels();
+
+    std::vector<uint8_t> pixels(n * channels);
+    std::vector<uint8_t> expected(n * t->led_size()), actual(expected.size());
+
+    check(t->render_loop((color_mode)3, false, false) == nullptr, "%s: unknown color mode", name);
+
+    printf("%s:", name);
+
+    for (auto mode: { color_mode::rgb, color_mode::hsv, color_mode::hsl }) {
+        for (bool corrected: { false, true }) {
+            for (bool extract_white: { false, true }) {
+                auto const loop = t->render_loop(mode, corrected, extract_white);
+                check(loop != nullptr, "%s: no loop for mode %d", name, (int)mode);
+
+                /* every value of every channel, in a few different neighbourhoods */
+                for (size_t round = 0; round < 256; ++round) {
+                    for (size_t i = 0; i < pixels.size(); ++i) {
+                        pixels[i] = i * 37 + round * 101 + (i / channels) * round;
+                    }
+
+                    per_pixel(t, expected.data(), pixels.data(), n, mode, corrected ? &lut : nullptr, extract_white);
+                    loop(actual.data(), pixels.data(), n, &lut);
+                    check(expected == actual, "%s: mode %d, corrected %d, extract white %d", name, (int)mode, corrected, extract_white);
+                }
+            }
+        }
+
+        auto const loop = t->render_loop(mode, false, false);
+        auto const frames = 2000;
+        auto const pixel_ns = test::ns_per(frames, [&](size_t) {
+            per_pixel(t, expected.data(), pixels.data(), n, mode, nullptr, false);
+            asm volatile("" ::: "memory");
+        }) / n;
+        auto const loop_ns = test::ns_per(frames, [&](size_t) {
+            loop(actual.data(), pixels.data(), n, nullptr);
+            asm volatile("" ::: "memory");
+        }) / n;
+        printf(" mode %d %.2f/%.2f,", (int)mode, pixel_ns, loop_ns);
+    }
+
+    printf(" ns/pixel per-pixel/specialized, ok\n");
+}
+
+int main()
+{
+    static color::correction lut;
+    uint8_t const gains[3] = { 255, 200, 120 };
+    lut.build(22, gains, 180);
+
+    check_loops<spi::transcode_8mhz>("transcode_8mhz", lut);
+    check_loops<spi::transcode_8mhz_alt>("transcode_8mhz_alt", lut);
+    check_loops<spi::transcode_2m67>("transcode_2m67", lut);
+    check_loops<spi::transcode_rgbw_8mhz>("transcode_rgbw_8mhz", lut);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef struct { void *dummy; } StaticTask_t;
+typedef struct tskTaskControlBlock *TaskHandle_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define portMAX_DELAY       0xffffffffUL
+#define configTICK_RATE_HZ  1024
+
+#define pdMS_TO_TICKS(MS) ((TickType_t)(((uint64_t)(MS) * configTICK_RATE_HZ) / 1000))
+#define portYIELD_FROM_ISR(X) ((void)(X))
+
+/* the RTC that drives the tick */
+#define portNRF_RTC_REG (&test_rtc1)
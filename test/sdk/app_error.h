@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "app_util_platform.h"
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS                 0
+#define NRF_ERROR_INTERNAL          3
+#define NRF_ERROR_NO_MEM            4
+#define NRF_ERROR_NOT_FOUND         5
+#define NRF_ERROR_NOT_SUPPORTED     6
+#define NRF_ERROR_INVALID_PARAM     7
+#define NRF_ERROR_INVALID_STATE     8
+#define NRF_ERROR_INVALID_LENGTH    9
+#define NRF_ERROR_INVALID_DATA      11
+#define NRF_ERROR_TIMEOUT           13
+#define NRF_ERROR_NULL              14
+#define NRF_ERROR_BUSY              17
+#define NRF_ERROR_RESOURCES         19
+
+#define BASE_ERROR_NUMBER           0x9000
+
+#define APP_ERROR_HANDLER(ERR) do {\
+        fprintf(stderr, "%s:%d: error 0x%x\n", __FILE__, __LINE__, (unsigned)(ERR));\
+        abort();\
+    } while (0)
+
+#define APP_ERROR_CHECK(ERR) do {\
+        ret_code_t const err_ = (ERR);\
+        if (err_ != NRF_SUCCESS) {\
+            APP_ERROR_HANDLER(err_);\
+        }\
+    } while (0)
+
+#define VERIFY_SUCCESS(ERR) do {\
+        ret_code_t const err_ = (ERR);\
+        if (err_ != NRF_SUCCESS) {\
+            return err_;\
+        }\
+    } while (0)
@@ -0,0 +1,5 @@
+#pragma once
+
+/* the host tests are single threaded where it matters */
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT() }
@@ -0,0 +1,53 @@
+#pragma once
+
+/* the SoftDevice's GATT server, as far as the services use it */
+
+#include <stdint.h>
+
+typedef struct { uint8_t broadcast:1, read:1, write_wo_resp:1, write:1, notify:1, indicate:1, auth_signed_wr:1; } ble_gatt_char_props_t;
+typedef struct { uint16_t handle; uint16_t offset; uint16_t len; uint8_t data[1]; } ble_gatts_evt_write_t;
+typedef struct { uint8_t format; int8_t exponent; uint16_t unit; uint8_t name_space; uint16_t desc; } ble_gatts_char_pf_t;
+typedef struct { uint16_t value_handle; uint16_t user_desc_handle; uint16_t cccd_handle; uint16_t sccd_handle; } ble_gatts_char_handles_t;
+typedef struct { uint16_t uuid; uint8_t type; } ble_uuid_t;
+typedef struct { uint8_t sm:4, lv:4; } ble_gap_conn_sec_mode_t;
+typedef struct { ble_gap_conn_sec_mode_t read_perm, write_perm; uint8_t vlen:1, vloc:2, rd_auth:1, wr_auth:1; } ble_gatts_attr_md_t;
+typedef struct { ble_uuid_t const *p_uuid; ble_gatts_attr_md_t const *p_attr_md; uint16_t init_len, init_offs, max_len; uint8_t *p_value; } ble_gatts_attr_t;
+typedef struct { ble_gatt_char_props_t char_props; uint8_t *p_char_user_desc; uint16_t char_user_desc_max_size, char_user_desc_size; ble_gatts_char_pf_t const *p_char_pf; } ble_gatts_char_md_t;
+typedef struct { uint16_t len; uint16_t offset; uint8_t *p_value; } ble_gatts_value_t;
+typedef struct { uint16_t handle; uint8_t type; uint16_t offset; uint16_t *p_len; uint8_t const *p_data; } ble_gatts_hvx_params_t;
+typedef struct { int unused; } ble_adv_modes_config_t;
+
+typedef struct {
+    struct { uint16_t evt_id; uint16_t evt_len; } header;
+    union {
+        struct { uint16_t conn_handle; union { ble_gatts_evt_write_t write; } params; } gatts_evt;
+    } evt;
+} ble_evt_t;
+
+#define BLE_GATT_HANDLE_INVALID 0x0000
+#define BLE_CONN_HANDLE_INVALID 0xffff
+#define BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION 0x13
+#define BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION 0x16
+#define BLE_GATT_CPF_NAMESPACE_BTSIG 0x01
+#define BLE_GATT_CPF_NAMESPACE_DESCRIPTION_UNKNOWN 0x0000
+#define BLE_GATT_CPF_FORMAT_UINT8 0x04
+#define BLE_GATT_CPF_FORMAT_UINT16 0x06
+#define BLE_GATT_CPF_FORMAT_UINT32 0x08
+#define BLE_GATT_CPF_FORMAT_UTF8S 0x19
+#define BLE_GATT_CPF_FORMAT_STRUCT 0x1b
+#define BLE_GAP_EVT_CONNECTED 0x10
+#define BLE_GAP_EVT_DISCONNECTED 0x11
+#define BLE_GATTS_EVT_WRITE 0x50
+#define BLE_GATTS_VLOC_STACK 0x01
+#define BLE_GATTS_VLOC_USER 0x02
+#define BLE_GATTS_SRVC_TYPE_PRIMARY 0x01
+#define BLE_GATT_HVX_NOTIFICATION 0x01
+#define BLE_ERROR_INVALID_CONN_HANDLE 0x3002
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr) do { (ptr)->sm = 1; (ptr)->lv = 1; } while (0)
+
+/* implemented by the test */
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const *p_uuid, uint16_t *p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const *p_char_md, ble_gatts_attr_t const *p_attr_char_value, ble_gatts_char_handles_t *p_handles);
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t *p_value);
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const *p_hvx_params);
+uint32_t sd_nvic_SystemReset(void);
@@ -0,0 +1,20 @@
+#pragma once
+
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#include <stdint.h>
+
+/* registers are plain memory, which stays 0 unless a test sets it */
+typedef struct { volatile uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { volatile uint32_t COUNTER; } NRF_RTC_Type;
+
+inline DWT_Type test_dwt;
+inline NRF_RTC_Type test_rtc1;
+inline uint32_t SystemCoreClock = 64000000;
+
+#define DWT (&test_dwt)
+#define RTC_COUNTER_COUNTER_Msk 0xffffffUL
+
+/* the NVIC, as far as the tests' models of peripherals need it */
+typedef int IRQn_Type;
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef volatile uint32_t nrf_atomic_u32_t;
+
+inline uint32_t nrf_atomic_u32_fetch_store(nrf_atomic_u32_t *p_data, uint32_t value) { return __atomic_exchange_n(p_data, value, __ATOMIC_SEQ_CST); }
+inline uint32_t nrf_atomic_u32_fetch_add(nrf_atomic_u32_t *p_data, uint32_t value) { return __atomic_fetch_add(p_data, value, __ATOMIC_SEQ_CST); }
+inline uint32_t nrf_atomic_u32_add(nrf_atomic_u32_t *p_data, uint32_t value) { return __atomic_add_fetch(p_data, value, __ATOMIC_SEQ_CST); }
+
+/* subtract, unless that would go below 0 */
+inline uint32_t nrf_atomic_u32_fetch_sub_hs(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    uint32_t old = *p_data;
+    while (old >= value && !__atomic_compare_exchange_n(p_data, &old, old - value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    }
+    return old;
+}
+
+inline uint32_t nrf_atomic_u32_sub_hs(nrf_atomic_u32_t *p_data, uint32_t value)
+{
+    uint32_t const old = nrf_atomic_u32_fetch_sub_hs(p_data, value);
+    return old >= value ? old - value : old;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#define NRF_LOG_ERROR(...)
+#define NRF_LOG_WARNING(...)
+#define NRF_LOG_INFO(...)
+#define NRF_LOG_DEBUG(...)
+#define NRF_LOG_FLUSH()
+#define NRF_LOG_MODULE_REGISTER() static_assert(true, "")
@@ -0,0 +1,27 @@
+#pragma once
+
+/* observers register themselves when constructed, for the test to call */
+
+#include <stddef.h>
+#include "ble_advertising.h"
+
+typedef void (*nrf_sdh_ble_evt_handler_t)(ble_evt_t const *p_ble_evt, void *p_context);
+
+struct nrf_sdh_ble_evt_observer_t {
+    nrf_sdh_ble_evt_observer_t(nrf_sdh_ble_evt_handler_t h, void *context);
+
+    nrf_sdh_ble_evt_handler_t handler;
+    void *p_context;
+};
+
+inline nrf_sdh_ble_evt_observer_t *nrf_sdh_ble_observers[32];
+inline size_t nrf_sdh_ble_n_observers = 0;
+
+inline nrf_sdh_ble_evt_observer_t::nrf_sdh_ble_evt_observer_t(nrf_sdh_ble_evt_handler_t h, void *context):
+    handler(h),
+    p_context(context)
+{
+    nrf_sdh_ble_observers[nrf_sdh_ble_n_observers++] = this;
+}
+
+#define NRF_SDH_BLE_OBSERVER(name, prio, handler, context) static nrf_sdh_ble_evt_observer_t name(handler, context)
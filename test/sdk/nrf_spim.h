@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* the nRF52840 has SPIM3, which runs at 16 and 32MHz */
+#define SPIM_FREQUENCY_FREQUENCY_M32 0x14000000UL
+
+typedef enum {
+    NRF_SPIM_FREQ_125K = 0x02000000,
+    NRF_SPIM_FREQ_250K = 0x04000000,
+    NRF_SPIM_FREQ_500K = 0x08000000,
+    NRF_SPIM_FREQ_1M = 0x10000000,
+    NRF_SPIM_FREQ_2M = 0x20000000,
+    NRF_SPIM_FREQ_4M = 0x40000000,
+    NRF_SPIM_FREQ_8M = 0x80000000,
+    NRF_SPIM_FREQ_16M = 0x0A000000,
+    NRF_SPIM_FREQ_32M = 0x14000000,
+} nrf_spim_frequency_t;
+
+typedef enum { NRF_SPIM_MODE_0, NRF_SPIM_MODE_1, NRF_SPIM_MODE_2, NRF_SPIM_MODE_3 } nrf_spim_mode_t;
+typedef enum { NRF_SPIM_BIT_ORDER_MSB_FIRST, NRF_SPIM_BIT_ORDER_LSB_FIRST } nrf_spim_bit_order_t;
+typedef enum { NRF_SPIM_TASK_START, NRF_SPIM_TASK_STOP } nrf_spim_task_t;
+typedef enum { NRF_SPIM_EVENT_END, NRF_SPIM_EVENT_ENDTX, NRF_SPIM_EVENT_STARTED } nrf_spim_event_t;
+
+typedef struct {
+    int instance;
+} NRF_SPIM_Type;
+
+/* implemented by the test's model of the peripheral */
+void nrf_spim_task_trigger(NRF_SPIM_Type *p_reg, nrf_spim_task_t task);
+bool nrf_spim_event_check(NRF_SPIM_Type *p_reg, nrf_spim_event_t event);
+void nrf_spim_event_clear(NRF_SPIM_Type *p_reg, nrf_spim_event_t event);
+void nrf_spim_tx_buffer_set(NRF_SPIM_Type *p_reg, uint8_t const *p_buffer, size_t length);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+#include "nrf.h"
+
+typedef enum { NRF_TIMER_MODE_TIMER, NRF_TIMER_MODE_COUNTER } nrf_timer_mode_t;
+typedef enum { NRF_TIMER_BIT_WIDTH_16, NRF_TIMER_BIT_WIDTH_8, NRF_TIMER_BIT_WIDTH_24, NRF_TIMER_BIT_WIDTH_32 } nrf_timer_bit_width_t;
+typedef enum { NRF_TIMER_FREQ_16MHz } nrf_timer_frequency_t;
+typedef enum { NRF_TIMER_CC_CHANNEL0, NRF_TIMER_CC_CHANNEL1, NRF_TIMER_CC_CHANNEL2, NRF_TIMER_CC_CHANNEL3 } nrf_timer_cc_channel_t;
+typedef enum { NRF_TIMER_EVENT_COMPARE0, NRF_TIMER_EVENT_COMPARE1, NRF_TIMER_EVENT_COMPARE2, NRF_TIMER_EVENT_COMPARE3 } nrf_timer_event_t;
+typedef enum { NRF_TIMER_TASK_START, NRF_TIMER_TASK_STOP, NRF_TIMER_TASK_COUNT, NRF_TIMER_TASK_CLEAR } nrf_timer_task_t;
+
+typedef struct {
+    int instance;
+} NRF_TIMER_Type;
+
+/* implemented by the test's model of the peripheral */
+void nrf_timer_event_clear(NRF_TIMER_Type *p_reg, nrf_timer_event_t event);
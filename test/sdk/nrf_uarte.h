@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* a plain integer, as `uarte::transport::init` switches on it with its own values */
+typedef uint32_t nrf_uarte_baudrate_t;
+#define NRF_UARTE_BAUDRATE_250000 0x04000000UL
+
+typedef enum { NRF_UARTE_STOPBITS_1, NRF_UARTE_STOPBITS_2 } nrf_uarte_stop_t;
+typedef enum { NRF_UARTE_EVENT_RXDRDY, NRF_UARTE_EVENT_ENDRX, NRF_UARTE_EVENT_ERROR, NRF_UARTE_EVENT_RXSTARTED } nrf_uarte_event_t;
+typedef enum { NRF_UARTE_SHORT_ENDRX_STARTRX = 1 << 5 } nrf_uarte_short_t;
+
+#define NRF_UARTE_ERROR_BREAK_MASK (1UL << 3)
+
+typedef struct {
+    int instance;
+} NRF_UARTE_Type;
+
+/* implemented by the test's model of the peripheral */
+bool nrf_uarte_event_check(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event);
+void nrf_uarte_event_clear(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event);
+uint32_t nrf_uarte_event_address_get(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event);
+void nrf_uarte_shorts_disable(NRF_UARTE_Type *p_reg, uint32_t mask);
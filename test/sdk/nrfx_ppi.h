@@ -0,0 +1,11 @@
+#pragma once
+
+#include "app_error.h"
+
+typedef enum { NRF_PPI_CHANNEL0 } nrf_ppi_channel_t;
+
+/* implemented by the test's model of the peripheral */
+ret_code_t nrfx_ppi_channel_alloc(nrf_ppi_channel_t *p_channel);
+ret_code_t nrfx_ppi_channel_assign(nrf_ppi_channel_t channel, uint32_t eep, uint32_t tep);
+ret_code_t nrfx_ppi_channel_enable(nrf_ppi_channel_t channel);
+ret_code_t nrfx_ppi_channel_disable(nrf_ppi_channel_t channel);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "app_error.h"
+#include "nrf_spim.h"
+
+#define NRFX_CHECK(X) (X)
+
+typedef struct {
+    NRF_SPIM_Type *p_reg;
+    uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+#define NRFX_SPIM_INSTANCE(ID) { nullptr, ID }
+
+typedef struct {
+    uint8_t sck_pin;
+    uint8_t mosi_pin;
+    uint8_t miso_pin;
+    uint8_t ss_pin;
+    nrf_spim_frequency_t frequency;
+    nrf_spim_mode_t mode;
+    nrf_spim_bit_order_t bit_order;
+} nrfx_spim_config_t;
+
+#define NRFX_SPIM_DEFAULT_CONFIG {}
+
+typedef struct {
+    uint8_t const *p_tx_buffer;
+    size_t tx_length;
+    uint8_t *p_rx_buffer;
+    size_t rx_length;
+} nrfx_spim_xfer_desc_t;
+
+#define NRFX_SPIM_XFER_TX(BUF, LEN) { (BUF), (LEN), nullptr, 0 }
+
+#define NRFX_SPIM_FLAG_HOLD_XFER        (1UL << 3)
+#define NRFX_SPIM_FLAG_REPEATED_XFER    (1UL << 4)
+
+typedef enum { NRFX_SPIM_EVENT_DONE } nrfx_spim_evt_type_t;
+
+typedef struct {
+    nrfx_spim_evt_type_t type;
+    nrfx_spim_xfer_desc_t xfer_desc;
+} nrfx_spim_evt_t;
+
+typedef void (*nrfx_spim_evt_handler_t)(nrfx_spim_evt_t const *p_event, void *p_context);
+
+/* implemented by the test's model of the peripheral */
+ret_code_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config, nrfx_spim_evt_handler_t handler, void *p_context);
+ret_code_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc, uint32_t flags);
+uint32_t nrfx_spim_start_task_get(nrfx_spim_t const *p_instance);
+uint32_t nrfx_spim_end_event_get(nrfx_spim_t const *p_instance);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "app_error.h"
+#include "nrf_timer.h"
+
+typedef struct {
+    NRF_TIMER_Type *p_reg;
+    uint8_t instance_id;
+    uint8_t cc_channel_count;
+} nrfx_timer_t;
+
+typedef struct {
+    nrf_timer_frequency_t frequency;
+    nrf_timer_mode_t mode;
+    nrf_timer_bit_width_t bit_width;
+    uint8_t interrupt_priority;
+    void *p_context;
+} nrfx_timer_config_t;
+
+#define NRFX_TIMER_DEFAULT_CONFIG {}
+
+typedef void (*nrfx_timer_event_handler_t)(nrf_timer_event_t event_type, void *p_context);
+
+/* implemented by the test's model of the peripheral */
+ret_code_t nrfx_timer_init(nrfx_timer_t const *p_instance, nrfx_timer_config_t const *p_config, nrfx_timer_event_handler_t timer_event_handler);
+void nrfx_timer_enable(nrfx_timer_t const *p_instance);
+void nrfx_timer_clear(nrfx_timer_t const *p_instance);
+uint32_t nrfx_timer_capture(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel);
+void nrfx_timer_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel, uint32_t cc_value, bool enable_int);
+void nrfx_timer_compare_int_disable(nrfx_timer_t const *p_instance, uint32_t channel);
+uint32_t nrfx_timer_task_address_get(nrfx_timer_t const *p_instance, nrf_timer_task_t timer_task);
+IRQn_Type nrfx_get_irq_number(void const *p_reg);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include "app_error.h"
+#include "nrf_uarte.h"
+
+typedef struct {
+    NRF_UARTE_Type *p_reg;
+    uint8_t drv_inst_idx;
+} nrfx_uarte_t;
+
+#define NRFX_UARTE_INSTANCE(ID) { nullptr, ID }
+
+typedef struct {
+    uint32_t pseltxd;
+    uint32_t pselrxd;
+    void *p_context;
+    nrf_uarte_baudrate_t baudrate;
+    nrf_uarte_stop_t stop;
+    uint8_t interrupt_priority;
+} nrfx_uarte_config_t;
+
+#define NRFX_UARTE_DEFAULT_CONFIG {}
+
+typedef enum { NRFX_UARTE_EVT_TX_DONE, NRFX_UARTE_EVT_RX_DONE, NRFX_UARTE_EVT_ERROR } nrfx_uarte_evt_type_t;
+
+typedef struct {
+    uint8_t *p_data;
+    size_t bytes;
+} nrfx_uarte_xfer_evt_t;
+
+typedef struct {
+    nrfx_uarte_xfer_evt_t rxtx;
+    uint32_t error_mask;
+} nrfx_uarte_error_evt_t;
+
+typedef struct {
+    nrfx_uarte_evt_type_t type;
+    union {
+        nrfx_uarte_xfer_evt_t rxtx;
+        nrfx_uarte_error_evt_t error;
+    } data;
+} nrfx_uarte_event_t;
+
+typedef void (*nrfx_uarte_event_handler_t)(nrfx_uarte_event_t const *p_event, void *p_context);
+
+/* implemented by the test's model of the peripheral */
+ret_code_t nrfx_uarte_init(nrfx_uarte_t const *p_instance, nrfx_uarte_config_t const *p_config, nrfx_uarte_event_handler_t event_handler);
+ret_code_t nrfx_uarte_rx(nrfx_uarte_t const *p_instance, uint8_t *p_data, size_t length);
+void nrfx_uarte_rx_abort(nrfx_uarte_t const *p_instance);
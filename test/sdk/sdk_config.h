@@ -0,0 +1,17 @@
+#pragma once
+
+/* the application's settings, as a typical nRF52840 build has them */
+#define MAX_LED_CHANNELS            4
+#define MAX_LEDS_PER_THREAD         300
+#define DEFAULT_REFRESH_RATE_MSEC   25
+#define MINIMUM_REFRESH_RATE_MSEC   10
+#define MAXIMUM_REFRESH_RATE_MSEC   1000
+#define MAX_USER_APP_SLOTS          32
+
+#define NRFX_SPIM0_ENABLED          0
+#define NRFX_SPIM1_ENABLED          0
+#define NRFX_SPIM2_ENABLED          1
+#define NRFX_SPIM3_ENABLED          1
+
+#define NRFX_UARTE0_ENABLED         1
+#define NRFX_UARTE1_ENABLED         0
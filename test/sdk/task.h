@@ -0,0 +1,11 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+inline void vTaskSuspendAll(void) {}
+
+typedef struct { TickType_t xTimeOnEntering; } TimeOut_t;
+
+/* no time passes on the host, so a wait only ends when there is nothing to wait for */
+inline void vTaskSetTimeOutState(TimeOut_t *pxTimeOut) { pxTimeOut->xTimeOnEntering = 0; }
+inline BaseType_t xTaskCheckForTimeOut(TimeOut_t *pxTimeOut, TickType_t *pxTicksToWait) { return *pxTicksToWait == 0; }
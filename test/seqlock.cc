@@ -0,0 +1,110 @@
+/* task::seqlock, with one writer and several readers on real threads */
+#include "nrf.h"
+#include "task/seqlock.hh"
+#include "test.hh"
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/* big enough that a copy takes a while, and every byte says which write it came from */
+struct frame {
+    uint32_t count;
+    uint8_t bytes[509];
+};
+
+static task::seqlock<frame> m_lock;
+static std::atomic<bool> m_stop { false };
+
+static void write_frame(uint32_t count)
+{
+    auto f = m_lock.begin_write();
+    f->count = count;
+    memset(f->bytes, (uint8_t)count, sizeof(f->bytes));
+    m_lock.publish();
+}
+
+struct reader_stats {
+    size_t reads = 0;
+    size_t skipped = 0;
+};
+
+static void reader(reader_stats *stats, size_t index)
+{
+    uint32_t version = 0;
+    uint32_t last_count = 0;
+    size_t calls = 0;
+    frame copy;
+
+    while (!m_stop) {
+        auto const copy_frame = [&](frame const &f) {
+            /* sometimes let the writer in halfway through the copy */
+            auto const half = sizeof(copy) / 2;
+            memcpy(&copy, &f, half);
+            if (++calls % 4 == 0) {
+                std::this_thread::yield();
+            }
+            memcpy((uint8_t*)&copy + half, (uint8_t const*)&f + half, sizeof(copy) - half);
+        };
+
+        if (!m_lock.read(&version, copy_frame)) {
+            stats->skipped += 1;
+            std::this_thread::yield();
+            continue;
+        }
+        stats->reads += 1;
+
+        for (auto byte: copy.bytes) {
+            check(byte == (uint8_t)copy.count, "reader %zu: torn read of write %u", index, copy.count);
+        }
+        check(copy.count > last_count, "reader %zu: write %u after write %u", index, copy.count, last_count);
+        last_count = copy.count;
+    }
+}
+
+int main()
+{
+    /* nothing new, nothing read */
+    uint32_t version = 0;
+    auto called = false;
+    check(!m_lock.read(&version, [&](frame const&) { called = true; }) && !called, "read before the first publish");
+
+    write_frame(1);
+    frame copy;
+    check(m_lock.read(&version, [&](frame const &f) { copy = f; }) && copy.count == 1, "read after a publish");
+    check(!m_lock.read(&version, [&](frame const&) { called = true; }) && !called, "read of the same version twice");
+
+    /* the stress test proper, which on one core still preempts readers mid-copy */
+    size_t const n_readers = std::max(4u, std::thread::hardware_concurrency()) - 1;
+    std::vector<reader_stats> stats(n_readers);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < n_readers; ++i) {
+        readers.emplace_back(reader, &stats[i], i);
+    }
+
+    uint32_t count = 1;
+    auto const end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < end) {
+        for (size_t i = 0; i < 1000; ++i) {
+            write_frame(++count);
+        }
+        std::this_thread::yield();
+    }
+
+    m_stop = true;
+    for (auto &t: readers) {
+        t.join();
+    }
+
+    check(m_lock.peek().count == count, "peek");
+
+    size_t reads = 0, skipped = 0;
+    for (auto &s: stats) {
+        reads += s.reads;
+        skipped += s.skipped;
+    }
+    check(reads > 0, "no reads");
+
+    printf("seqlock: ok, %u writes, %zu reads by %zu readers, %zu unchanged\n", count, reads, n_readers, skipped);
+    return 0;
+}
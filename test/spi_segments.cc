@@ -0,0 +1,82 @@
+/* Frames sent as segment lists through spi::transport, on a model of the SPIM */
+#include "spim.hh"
+
+static bool m_done;
+
+template<typename Transcoder>
+static void check_segments(spi::transport &tp, size_t n_leds, unsigned seed)
+{
+    std::vector<color::rgb> pixels(n_leds);
+    srand(seed);
+    for (auto &p: pixels) {
+        p = color::rgb(rand(), rand(), rand());
+    }
+
+    /* the whole frame, bus resets included, as the transcoder writes it to one buffer */
+    std::vector<uint8_t> expect(2 * Transcoder::bytes_per_reset + n_leds * Transcoder::bytes_per_led);
+    buffer whole_buf(expect.data(), expect.size());
+    Transcoder whole(whole_buf);
+    whole.write_bus_reset();
+    whole.write_span(pixels.data(), n_leds);
+    whole.write_bus_reset();
+    check(whole.len() == expect.size(), "%zu LEDs: whole frame of %zu bytes", n_leds, whole.len());
+
+    /* only the pixels, with the bus resets sent from `led::zeros`, as `led::thread` does */
+    std::vector<uint8_t> pixel_bytes(n_leds * Transcoder::bytes_per_led);
+    buffer frame_buf(pixel_bytes.data(), pixel_bytes.size());
+    Transcoder frame(frame_buf);
+    frame.omit_bus_reset(true);
+    frame.write_bus_reset();
+    frame.write_span(pixels.data(), n_leds);
+    frame.write_bus_reset();
+    check(frame.len() == pixel_bytes.size(), "%zu LEDs: frame of %zu bytes holds bus resets", n_leds, frame.len());
+
+    led::segment const segments[] = {
+        { led::zeros, frame.reset_size() },
+        { frame.ptr(), frame.len() },
+        { led::zeros, frame.reset_size() },
+    };
+    check(tp.set_segments(segments, 3) == NRF_SUCCESS, "set_segments, %zu LEDs", n_leds);
+
+    m_done = false;
+    auto const parts_before = spim::totals.parts;
+    check(tp.send() == NRF_SUCCESS, "send, %zu LEDs", n_leds);
+    spim::run();
+
+    /* empty segments are skipped */
+    auto const parts = spim::totals.parts - parts_before;
+    check(m_done && parts == (n_leds ? 3u : 2u), "%zu LEDs: completion %d after %zu parts", n_leds, m_done, parts);
+    check(spim::wire == expect, "%zu LEDs: %zu bytes sent, %zu expected", n_leds, spim::wire.size(), expect.size());
+
+    /* the completion callback released the list */
+    check(tp.send() == ERROR_NO_BUFFER, "%zu LEDs: segments not released", n_leds);
+}
+
+int main()
+{
+    static_assert(spi::transcode_8mhz::bytes_per_reset <= LED_ZERO_REGION_SIZE);
+    static_assert(spi::transcode_2m67::bytes_per_reset <= LED_ZERO_REGION_SIZE);
+
+    static spi::transport tp((spi::id)0);
+    check(tp.init({ spi::FREQ_8M, 0, 0 }) == NRF_SUCCESS, "init");
+    tp.on_send_complete(nullptr, [](uint8_t *buffer, size_t length, BaseType_t *do_context_switch, void *context) {
+        m_done = true;
+        return true;
+    });
+
+    for (size_t n = 0; n <= 1200; ++n) {
+        check_segments<spi::transcode_8mhz>(tp, n, n);
+        check_segments<spi::transcode_8mhz_alt>(tp, n, n);
+        check_segments<spi::transcode_2m67>(tp, n, n);
+    }
+
+    for (size_t i = 0; i < LED_ZERO_REGION_SIZE; ++i) {
+        check(led::zeros[i] == 0, "led::zeros[%zu] was written to", i);
+    }
+
+    auto const &t = spim::totals;
+    check(t.stale == 0 && t.corrupt == 0, "%ld stale parts sent, %ld parts changed while sent", t.stale, t.corrupt);
+
+    printf("spi_segments: ok, %zu parts\n", t.parts);
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* Streamed frames through spi::transport, on a model of the SPIM */
+#include "spim.hh"
+#include "led/stream.hh"
+
+static bool m_done;
+
+template<typename Transcoder, typename Pixel>
+static void check_stream(spi::transport &tp, led::stream &strm, size_t n_leds, unsigned seed)
+{
+    std::vector<Pixel> pixels(n_leds);
+    srand(seed);
+    for (auto &p: pixels) {
+        for (size_t c = 0; c < sizeof(Pixel); ++c) {
+            ((uint8_t*)&p)[c] = rand();
+        }
+    }
+
+    /* the same frame, encoded up front */
+    std::vector<uint8_t> expect(2 * Transcoder::bytes_per_reset + Transcoder::encoder::bytes_per_header + n_leds * Transcoder::bytes_per_led);
+    buffer buf(expect.data(), expect.size());
+    Transcoder reference(buf);
+    reference.write_frame_start();
+    auto out = reference.reserve(n_leds);
+    if constexpr (sizeof(Pixel) == 4) {
+        reference.encode_rgbw(pixels.data(), n_leds, out);
+    } else {
+        reference.encode(pixels.data(), n_leds, out);
+    }
+    reference.write_bus_reset();
+
+    strm.set_frame((uint8_t const*)pixels.data(), n_leds);
+    check(tp.set_stream(&strm) == NRF_SUCCESS, "set_stream, %zu LEDs", n_leds);
+
+    m_done = false;
+    check(tp.send() == NRF_SUCCESS, "send, %zu LEDs", n_leds);
+    spim::run();
+
+    check(m_done, "no completion, %zu LEDs", n_leds);
+    check(spim::wire == expect, "%zu LEDs: %zu bytes sent, %zu expected", n_leds, spim::wire.size(), expect.size());
+}
+
+int main()
+{
+    static spi::transport tp((spi::id)0);
+    check(tp.init({ spi::FREQ_8M, 0, 0 }) == NRF_SUCCESS, "init");
+    tp.on_send_complete(nullptr, [](uint8_t *buffer, size_t length, BaseType_t *do_context_switch, void *context) {
+        m_done = true;
+        return false;
+    });
+
+    static spim::counting<spi::transcode_8mhz> rgb_encoder;
+    static led::stream rgb_stream(&rgb_encoder);
+    for (size_t n = 0; n <= 1200; ++n) {
+        check_stream<spi::transcode_8mhz, color::rgb>(tp, rgb_stream, n, n);
+    }
+
+    static spim::counting<spi::transcode_rgbw_8mhz> rgbw_encoder;
+    static led::stream rgbw_stream(&rgbw_encoder);
+    for (size_t n = 0; n <= 300; ++n) {
+        check_stream<spi::transcode_rgbw_8mhz, color::rgbw>(tp, rgbw_stream, n, n);
+    }
+
+    /* a header between the leading bus reset and the first LED */
+    using transcode_tm1814 = spi::transcode_chip<led::chips::tm1814<42>, spi::FREQ_8M>;
+    static spim::counting<transcode_tm1814> header_encoder;
+    static led::stream header_stream(&header_encoder);
+    for (size_t n = 0; n <= 300; ++n) {
+        check_stream<transcode_tm1814, color::rgbw>(tp, header_stream, n, n);
+    }
+
+    /* the chunks are too small to be refilled in time above 8MHz */
+    static spi::transport fast((spi::id)1);
+    for (auto frequency: { spi::FREQ_2M67, spi::FREQ_8M, spi::FREQ_16M, spi::FREQ_32M }) {
+        check(fast.init({ frequency, 0, 0 }) == NRF_SUCCESS, "init at frequency %u", frequency);
+        ret_code_t const expect = led::stream::keeps_up(fast.byte_rate()) ? NRF_SUCCESS : NRF_ERROR_NOT_SUPPORTED;
+        check(fast.set_stream(&rgb_stream) == expect, "set_stream at frequency %u", frequency);
+        check((expect == NRF_SUCCESS) == (frequency == spi::FREQ_2M67 || frequency == spi::FREQ_8M), "keeps_up at frequency %u", frequency);
+    }
+
+    auto const &t = spim::totals;
+    check(t.misses == 0 && t.stale == 0 && t.corrupt == 0, "%ld refills late, %ld stale parts sent, %ld parts changed while sent",
+        t.misses, t.stale, t.corrupt);
+
+    printf("spi_stream: ok, %zu parts, worst refill margin %.1fus of %.0fus at 8MHz\n",
+        t.parts, t.worst_margin_us, LED_STREAM_CHUNK_SIZE * 8 / spim::spi_hz * 1e6);
+    return 0;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "periph/spi.hh"
+#include "nrfx_spim.h"
+#include "nrfx_ppi.h"
+#include "test.hh"
+#include <vector>
+
+/* A model of the SPIM with EasyDMA and the END->START PPI channel that
+ * `spi::transport` chains transfers with, and of the time its interrupt
+ * handler takes. Transfers take their airtime at `spi_hz`. When one ends,
+ * the PPI channel starts the next from whatever TXD.PTR holds, and then
+ * the handler runs. Its time on the CPU grows with the LEDs it encodes and
+ * the bytes it fills, and it has to load the next TXD.PTR before the
+ * transfer in flight ends. */
+namespace spim {
+    struct cost_model {
+        double cpu_hz = 64e6;
+        double isr_cycles = 400;        /* entry, nrfx dispatch, and the chain bookkeeping */
+        double led_cycles = 150;        /* per LED encoded, with flash wait states */
+        double byte_cycles = 0.5;       /* per byte of the part that was loaded */
+        double latency_us = 0;          /* before the handler runs, e.g. from the SoftDevice */
+    };
+
+    struct stats {
+        size_t parts = 0;
+        long misses = 0;        /* TXD.PTR loaded after the transfer before it ended */
+        long stale = 0;         /* the PPI channel started a part that was sent already */
+        long corrupt = 0;       /* a part changed while it was being sent */
+        double worst_margin_us = 1e9;
+    };
+
+    inline cost_model cost;
+    inline stats totals;
+    inline double spi_hz = 8e6;
+    inline size_t leds_encoded;     /* by the handler that is running */
+    inline std::vector<uint8_t> wire;
+
+    namespace detail {
+        struct txd_t { uint8_t const *ptr; size_t len; bool fresh; };
+        struct inflight_t { bool active; uint8_t const *ptr; std::vector<uint8_t> sent; double end_us; };
+
+        inline txd_t txd;
+        inline inflight_t inflight;
+        inline bool ppi_enabled, started, in_handler;
+        inline double now_us, handler_start_us;
+        inline nrfx_spim_evt_handler_t handlers[4];
+        inline void *contexts[4];
+        inline uint8_t active_idx;
+
+        inline void start()
+        {
+            check(!inflight.active, "START while a transfer is in flight");
+            inflight.active = true;
+            inflight.ptr = txd.ptr;
+            inflight.sent.assign(txd.ptr, txd.ptr + txd.len);
+            inflight.end_us = now_us + txd.len * 8 / spi_hz * 1e6;
+            txd.fresh = false;
+            started = true;
+        }
+    }
+
+    /* counts the LEDs that the handler encodes, for the cost model */
+    template<typename Transcoder>
+    struct counting: Transcoder {
+        void encode(color::rgb const *values, size_t n, uint8_t *out) override
+        {
+            leds_encoded += n;
+            Transcoder::encode(values, n, out);
+        }
+
+        void encode_rgbw(color::rgbw const *values, size_t n, uint8_t *out) override
+        {
+            leds_encoded += n;
+            Transcoder::encode_rgbw(values, n, out);
+        }
+    };
+
+    /**
+     * @brief Run the transfers that `tp.send()` started, until there are
+     *        none left, and collect what went out on the wire.
+     */
+    inline void run()
+    {
+        using namespace detail;
+
+        wire.clear();
+        while (inflight.active) {
+            now_us = inflight.end_us;
+            totals.parts += 1;
+            if (memcmp(inflight.sent.data(), inflight.ptr, inflight.sent.size()) != 0) {
+                totals.corrupt += 1;
+            }
+            wire.insert(wire.end(), inflight.sent.begin(), inflight.sent.end());
+            inflight.active = false;
+
+            if (ppi_enabled) {
+                if (!txd.fresh) {
+                    totals.stale += 1;
+                }
+                start();
+            }
+
+            handler_start_us = now_us + cost.latency_us;
+            leds_encoded = 0;
+            in_handler = true;
+            nrfx_spim_evt_t const event = { NRFX_SPIM_EVENT_DONE, {} };
+            handlers[active_idx](&event, contexts[active_idx]);
+            in_handler = false;
+        }
+    }
+}
+
+ret_code_t nrfx_spim_init(nrfx_spim_t const *p_instance, nrfx_spim_config_t const *p_config, nrfx_spim_evt_handler_t handler, void *p_context)
+{
+    spim::detail::handlers[p_instance->drv_inst_idx] = handler;
+    spim::detail::contexts[p_instance->drv_inst_idx] = p_context;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_spim_xfer(nrfx_spim_t const *p_instance, nrfx_spim_xfer_desc_t const *p_xfer_desc, uint32_t flags)
+{
+    spim::detail::active_idx = p_instance->drv_inst_idx;
+    spim::detail::txd = { p_xfer_desc->p_tx_buffer, p_xfer_desc->tx_length, true };
+    return NRF_SUCCESS;
+}
+
+uint32_t nrfx_spim_start_task_get(nrfx_spim_t const *p_instance)
+{
+    return 1;
+}
+
+uint32_t nrfx_spim_end_event_get(nrfx_spim_t const *p_instance)
+{
+    return 2;
+}
+
+void nrf_spim_task_trigger(NRF_SPIM_Type *p_reg, nrf_spim_task_t task)
+{
+    if (task == NRF_SPIM_TASK_START) {
+        spim::detail::start();
+    }
+}
+
+bool nrf_spim_event_check(NRF_SPIM_Type *p_reg, nrf_spim_event_t event)
+{
+    return event == NRF_SPIM_EVENT_STARTED && spim::detail::started;
+}
+
+void nrf_spim_event_clear(NRF_SPIM_Type *p_reg, nrf_spim_event_t event)
+{
+    if (event == NRF_SPIM_EVENT_STARTED) {
+        spim::detail::started = false;
+    }
+}
+
+void nrf_spim_tx_buffer_set(NRF_SPIM_Type *p_reg, uint8_t const *p_buffer, size_t length)
+{
+    using namespace spim::detail;
+    auto &cost = spim::cost;
+
+    if (in_handler) {
+        auto const cycles = cost.isr_cycles + spim::leds_encoded * cost.led_cycles + length * cost.byte_cycles;
+        auto const margin = inflight.end_us - (handler_start_us + cycles / cost.cpu_hz * 1e6);
+        spim::totals.worst_margin_us = std::min(spim::totals.worst_margin_us, margin);
+        if (margin < 0) {
+            spim::totals.misses += 1;
+        }
+    }
+
+    txd = { p_buffer, length, true };
+}
+
+ret_code_t nrfx_ppi_channel_alloc(nrf_ppi_channel_t *p_channel)
+{
+    *p_channel = NRF_PPI_CHANNEL0;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_ppi_channel_assign(nrf_ppi_channel_t channel, uint32_t eep, uint32_t tep)
+{
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_ppi_channel_enable(nrf_ppi_channel_t channel)
+{
+    spim::detail::ppi_enabled = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_ppi_channel_disable(nrf_ppi_channel_t channel)
+{
+    spim::detail::ppi_enabled = false;
+    return NRF_SUCCESS;
+}
+
+uint8_t led::zeros[LED_ZERO_REGION_SIZE];
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+
+/* end the test with a message if `expr` is false */
+#define check(expr, ...) do {\
+        if (!(expr)) {\
+            fprintf(stderr, "%s:%d: check failed: %s\n    ", __FILE__, __LINE__, #expr);\
+            fprintf(stderr, __VA_ARGS__);\
+            fputc('\n', stderr);\
+            exit(1);\
+        }\
+    } while (0)
+
+namespace test {
+    /**
+     * @brief Nanoseconds per iteration of `f(i)`, for `i` from 0 to `n`.
+     *
+     * For the benchmarks that the tests print. These are host timings, so
+     * they only compare implementations with each other, and are never
+     * checked.
+     */
+    template<typename F>
+    double ns_per(size_t n, F &&f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            f(i);
+        }
+        auto const end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / n;
+    }
+
+    /* keeps benchmarked results from being optimized away */
+    inline volatile uint32_t sink = 0;
+}
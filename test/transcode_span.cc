@@ -0,0 +1,62 @@
+/* write_span against one write() per pixel */
+#include "periph/spi.hh"
+#include "test.hh"
+#include <vector>
+
+template<typename Transcoder>
+static void check_span(char const *name)
+{
+    constexpr size_t max_leds = 300;
+    constexpr auto led_size = Transcoder::bytes_per_led;
+
+    std::vector<color::rgb> pixels(max_leds);
+    for (size_t i = 0; i < max_leds; ++i) {
+        pixels[i] = color::rgb(i, i * 7, i * 13);
+    }
+
+    std::vector<uint8_t> by_pixel(max_leds * led_size), by_span(max_leds * led_size);
+    buffer pixel_buf(by_pixel.data(), by_pixel.size()), span_buf(by_span.data(), by_span.size());
+    Transcoder per_pixel(pixel_buf), span(span_buf);
+    led::transcode *p = &per_pixel, *s = &span;
+
+    for (size_t n = 0; n <= max_leds; ++n) {
+        p->clear();
+        s->clear();
+        for (size_t i = 0; i < n; ++i) {
+            check(p->write(pixels[i]) == NRF_SUCCESS, "%s: write %zu", name, i);
+        }
+        check(s->write_span(pixels.data(), n) == NRF_SUCCESS, "%s: write_span of %zu", name, n);
+        check(p->len() == s->len() && memcmp(p->ptr(), s->ptr(), p->len()) == 0, "%s: %zu LEDs", name, n);
+    }
+
+    /* one check for the whole span, which either fits or isn't written at all */
+    s->clear();
+    check(s->write_span(pixels.data(), max_leds - 1) == NRF_SUCCESS, "%s: write_span", name);
+    check(s->write_span(pixels.data(), 2) == NRF_ERROR_INVALID_LENGTH, "%s: write_span past the end", name);
+    check(s->len() == (max_leds - 1) * led_size, "%s: %zu bytes after a failed write_span", name, s->len());
+
+    auto const n_frames = 2000;
+    auto const write_ns = test::ns_per(n_frames, [&](size_t) {
+        p->clear();
+        for (auto &value: pixels) {
+            p->write(value);
+        }
+        asm volatile("" ::: "memory");
+    }) / max_leds;
+    auto const span_ns = test::ns_per(n_frames, [&](size_t) {
+        s->clear();
+        s->write_span(pixels.data(), max_leds);
+        asm volatile("" ::: "memory");
+    }) / max_leds;
+
+    printf("%s: ok, write() %.2f ns/LED, write_span() %.2f ns/LED\n", name, write_ns, span_ns);
+}
+
+int main()
+{
+    check_span<spi::transcode_8mhz>("transcode_8mhz");
+    check_span<spi::transcode_8mhz_alt>("transcode_8mhz_alt");
+    check_span<spi::transcode_2m67>("transcode_2m67");
+    check_span<spi::transcode_rgbw_8mhz>("transcode_rgbw_8mhz");
+    return 0;
+}
@@ -0,0 +1,304 @@
+/* uarte::transport with a byte counter, on a model of the UARTE, its
+ * counter and the two interrupts, which run in the order the NVIC takes
+ * them: the UARTE's first, then the timer's. */
+#include "periph/uarte.hh"
+#include "nrfx_uarte.h"
+#include "nrfx_ppi.h"
+#include "dmx.hh"
+#include "test.hh"
+#include <deque>
+#include <vector>
+
+namespace hw {
+    constexpr IRQn_Type timer_irq = 9;
+
+    struct {
+        nrfx_uarte_event_handler_t handler;
+        void *context;
+        uint8_t *receiving;     /* started, or nullptr */
+        uint8_t *next;          /* queued behind it, or nullptr */
+        size_t n_bytes;         /* in `receiving` */
+        bool rxstarted;
+        bool break_pending;     /* the ERROR interrupt */
+    } uarte;
+
+    struct {
+        nrfx_timer_event_handler_t handler;
+        void *context;
+        uint32_t count;
+        uint32_t cc[2];
+        bool compare_int;
+        bool compare_event;     /* latched until cleared, and keeps the interrupt pending */
+        bool irq_pending;
+    } timer;
+
+    /* RXDRDY counts the byte through PPI before EasyDMA writes it */
+    static void rxdrdy(uint8_t byte)
+    {
+        if (++timer.count == timer.cc[0]) {
+            timer.compare_event = true;
+            timer.irq_pending |= timer.compare_int;
+        }
+        if (uarte.receiving) {
+            uarte.receiving[uarte.n_bytes++] = byte;
+        }
+    }
+
+    static void receive(std::vector<uint8_t> const &bytes)
+    {
+        for (auto b: bytes) {
+            rxdrdy(b);
+        }
+    }
+
+    /* a break is received as a 0 with a framing error, after which the
+     * driver drops both buffers */
+    static void receive_break()
+    {
+        rxdrdy(0);
+        uarte.break_pending = true;
+    }
+
+    static void run_irqs()
+    {
+        if (uarte.break_pending) {
+            uarte.break_pending = false;
+            uarte.receiving = uarte.next = nullptr;
+
+            nrfx_uarte_event_t event = {};
+            event.type = NRFX_UARTE_EVT_ERROR;
+            event.data.error.error_mask = NRF_UARTE_ERROR_BREAK_MASK;
+            uarte.handler(&event, uarte.context);
+        }
+
+        if (timer.irq_pending || (timer.compare_event && timer.compare_int)) {
+            timer.irq_pending = false;
+            /* what nrfx_timer's handler checks */
+            if (timer.compare_event && timer.compare_int) {
+                timer.compare_event = false;
+                timer.handler(NRF_TIMER_EVENT_COMPARE0, timer.context);
+            }
+        }
+    }
+}
+
+ret_code_t nrfx_uarte_init(nrfx_uarte_t const *p_instance, nrfx_uarte_config_t const *p_config, nrfx_uarte_event_handler_t event_handler)
+{
+    hw::uarte.handler = event_handler;
+    hw::uarte.context = p_config->p_context;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_uarte_rx(nrfx_uarte_t const *p_instance, uint8_t *p_data, size_t length)
+{
+    if (!hw::uarte.receiving) {
+        hw::uarte.receiving = p_data;
+        hw::uarte.n_bytes = 0;
+        hw::uarte.rxstarted = true;
+    } else if (!hw::uarte.next) {
+        hw::uarte.next = p_data;
+    } else {
+        return NRF_ERROR_BUSY;
+    }
+    return NRF_SUCCESS;
+}
+
+void nrfx_uarte_rx_abort(nrfx_uarte_t const *p_instance)
+{
+    hw::uarte.receiving = hw::uarte.next = nullptr;
+}
+
+bool nrf_uarte_event_check(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event)
+{
+    return event == NRF_UARTE_EVENT_RXSTARTED && hw::uarte.rxstarted;
+}
+
+void nrf_uarte_event_clear(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event)
+{
+    if (event == NRF_UARTE_EVENT_RXSTARTED) {
+        hw::uarte.rxstarted = false;
+    }
+}
+
+uint32_t nrf_uarte_event_address_get(NRF_UARTE_Type *p_reg, nrf_uarte_event_t event)
+{
+    return 0;
+}
+
+void nrf_uarte_shorts_disable(NRF_UARTE_Type *p_reg, uint32_t mask)
+{}
+
+ret_code_t nrfx_timer_init(nrfx_timer_t const *p_instance, nrfx_timer_config_t const *p_config, nrfx_timer_event_handler_t timer_event_handler)
+{
+    hw::timer.handler = timer_event_handler;
+    hw::timer.context = p_config->p_context;
+    return NRF_SUCCESS;
+}
+
+void nrfx_timer_enable(nrfx_timer_t const *p_instance)
+{}
+
+/* clears the count, not the events */
+void nrfx_timer_clear(nrfx_timer_t const *p_instance)
+{
+    hw::timer.count = 0;
+}
+
+uint32_t nrfx_timer_capture(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel)
+{
+    return hw::timer.cc[cc_channel] = hw::timer.count;
+}
+
+void nrfx_timer_compare(nrfx_timer_t const *p_instance, nrf_timer_cc_channel_t cc_channel, uint32_t cc_value, bool enable_int)
+{
+    hw::timer.cc[cc_channel] = cc_value;
+    hw::timer.compare_int = enable_int;
+}
+
+void nrfx_timer_compare_int_disable(nrfx_timer_t const *p_instance, uint32_t channel)
+{
+    hw::timer.compare_int = false;
+}
+
+uint32_t nrfx_timer_task_address_get(nrfx_timer_t const *p_instance, nrf_timer_task_t timer_task)
+{
+    return 0;
+}
+
+void nrf_timer_event_clear(NRF_TIMER_Type *p_reg, nrf_timer_event_t event)
+{
+    if (event == NRF_TIMER_EVENT_COMPARE0) {
+        hw::timer.compare_event = false;
+    }
+}
+
+IRQn_Type nrfx_get_irq_number(void const *p_reg)
+{
+    return hw::timer_irq;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    if (IRQn == hw::timer_irq) {
+        hw::timer.irq_pending = false;
+    }
+}
+
+ret_code_t nrfx_ppi_channel_alloc(nrf_ppi_channel_t *p_channel)
+{
+    *p_channel = NRF_PPI_CHANNEL0;
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_ppi_channel_assign(nrf_ppi_channel_t channel, uint32_t eep, uint32_t tep)
+{
+    return NRF_SUCCESS;
+}
+
+ret_code_t nrfx_ppi_channel_enable(nrf_ppi_channel_t channel)
+{
+    return NRF_SUCCESS;
+}
+
+struct QueueDefinition {
+    size_t length;
+    size_t item_size;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return new QueueDefinition { uxQueueLength, uxItemSize, {} };
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    if (xQueue->items.empty()) {
+        return pdFALSE;
+    }
+    memcpy(pvBuffer, xQueue->items.front().data(), xQueue->item_size);
+    xQueue->items.pop_front();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, void const *pvItemToQueue, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    if (xQueue->items.size() == xQueue->length) {
+        return pdFALSE;
+    }
+    auto const item = (uint8_t const*)pvItemToQueue;
+    xQueue->items.emplace_back(item, item + xQueue->item_size);
+    return pdTRUE;
+}
+
+static nrfx_timer_t const m_counter = { nullptr, 1, 4 };
+static uarte::transport m_transport(uarte::UARTE0);
+
+/* a dimmer frame whose slots all have the value `level` */
+static std::vector<uint8_t> dimmer_frame(size_t n_bytes, uint8_t level)
+{
+    std::vector<uint8_t> bytes(n_bytes, level);
+    bytes[0] = (uint8_t)dmx::start_code::dimmer;
+    return bytes;
+}
+
+static void check_frame(char const *what, size_t n_bytes, uint8_t level)
+{
+    dmx::rx_frame frame;
+    check(m_transport.receive(&frame, 0) == NRF_SUCCESS, "%s: no frame", what);
+    check(frame.length >= n_bytes, "%s: %zu bytes, %zu expected", what, frame.length, n_bytes);
+    check(frame.data[0] == (uint8_t)dmx::start_code::dimmer, "%s: start code 0x%02x", what, frame.data[0]);
+    for (size_t i = 1; i < n_bytes; ++i) {
+        check(frame.data[i] == level, "%s: slot %zu is %u, %u expected", what, i, frame.data[i], level);
+    }
+    m_transport.release(frame);
+}
+
+int main()
+{
+    constexpr size_t frame_size = 25;
+
+    auto const init = uarte::uarte_init { uarte::BAUD_250K, 0, true, &m_counter };
+    check(m_transport.init(init) == NRF_SUCCESS, "init");
+    m_transport.set_frame_size(frame_size);
+    check(m_transport.enable() == NRF_SUCCESS, "enable");
+
+    /* Longer frames are handed over at the byte after the first
+     * `frame_size` ones, by the timer interrupt. */
+    hw::receive(dimmer_frame(frame_size + 8, 0x11));
+    hw::run_irqs();
+    check_frame("longer frame", frame_size, 0x11);
+    hw::receive_break();
+    hw::run_irqs();
+
+    /* Every buffer once, so that the ones taken next hold old frames. */
+    for (uint8_t level = 0x20; level < 0x20 + DMX_RX_BUFFERS; ++level) {
+        hw::receive(dimmer_frame(frame_size - 4, level));
+        hw::receive_break();
+        hw::run_irqs();
+        check_frame("shorter frame", frame_size - 4, level);
+    }
+
+    /* A frame of exactly `frame_size` bytes: the break is the byte after
+     * them, so the compare event comes with the break. The UARTE interrupt
+     * hands the frame over and starts the next buffer, and the timer
+     * interrupt, which is pending behind it, must not hand that buffer
+     * over in its place. */
+    hw::receive(dimmer_frame(frame_size, 0x42));
+    hw::receive_break();
+    hw::run_irqs();
+    check_frame("frame of frame_size bytes", frame_size, 0x42);
+
+    dmx::rx_frame frame;
+    check(m_transport.receive(&frame, 0) == NRF_ERROR_TIMEOUT, "a frame that wasn't received, of %zu bytes", frame.length);
+
+    /* and the next one is handed over as usual */
+    hw::receive(dimmer_frame(frame_size + 1, 0x43));
+    hw::run_irqs();
+    check_frame("frame after it", frame_size, 0x43);
+    hw::receive_break();
+    hw::run_irqs();
+
+    printf("uarte_counter: ok, frames of %zu bytes end at the break, longer ones are lent\n", frame_size);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "led/chip.hh"
+#include "test.hh"
+#include <vector>
+
+namespace test {
+    /* the smallest distances to the edges of the datasheet windows, in ns */
+    struct margins {
+        int64_t high = INT64_MAX;   /* T0H or T1H, whichever the pulse was */
+        int64_t period = INT64_MAX;
+        int64_t low = INT64_MAX;    /* above `min_low_ns` */
+    };
+
+    /**
+     * @brief Decode a one-wire LED bitstream, sent MSB first with `bit_ps`
+     *        picoseconds per SPI bit, back into the bytes the chip sees.
+     *
+     * Every pulse must fall within `spec`: its high time in either the T0H
+     * or the T1H window, its period within the bit period window, and its
+     * low time at least `min_low_ns`. The low time of the last pulse runs
+     * into the bus reset, so its period isn't checked.
+     */
+    inline std::vector<uint8_t> decode(led::chip const &spec, uint8_t const *data, size_t length, uint32_t bit_ps, margins *m)
+    {
+        auto const level = [&](size_t i) -> bool {
+            return data[i / 8] & (0x80 >> (i % 8));
+        };
+        auto const n_bits = length * 8;
+
+        std::vector<uint8_t> out;
+        uint8_t byte = 0;
+        size_t n_decoded = 0;
+        size_t i = 0;
+
+        while (i < n_bits && !level(i)) {
+            ++i;
+        }
+
+        while (i < n_bits) {
+            size_t high = 0, low = 0;
+            for (; i < n_bits && level(i); ++i) {
+                ++high;
+            }
+            for (; i < n_bits && !level(i); ++i) {
+                ++low;
+            }
+
+            int64_t const high_ns = high * (int64_t)bit_ps / 1000;
+            int64_t const low_ns = low * (int64_t)bit_ps / 1000;
+            auto const in = [&](int64_t value, int64_t nominal, int64_t tolerance) {
+                return std::min(value - (nominal - tolerance), nominal + tolerance - value);
+            };
+
+            auto const zero = in(high_ns, spec.t0h_ns, spec.high_tolerance_ns);
+            auto const one = in(high_ns, spec.t1h_ns, spec.high_tolerance_ns);
+            check((zero >= 0) != (one >= 0), "bit %zu: high time %lldns is %s", n_decoded, (long long)high_ns,
+                zero >= 0 ? "both a 0 and a 1" : "neither a 0 nor a 1");
+            m->high = std::min(m->high, std::max(zero, one));
+
+            check(low_ns >= spec.min_low_ns, "bit %zu: low time %lldns", n_decoded, (long long)low_ns);
+            m->low = std::min<int64_t>(m->low, low_ns - spec.min_low_ns);
+
+            if (i < n_bits) {
+                auto const period = in(high_ns + low_ns, spec.period_ns, spec.period_tolerance_ns);
+                check(period >= 0, "bit %zu: period %lldns", n_decoded, (long long)(high_ns + low_ns));
+                m->period = std::min(m->period, period);
+            }
+
+            byte = (byte << 1) | (one >= 0);
+            if (++n_decoded % 8 == 0) {
+                out.push_back(byte);
+            }
+        }
+
+        check(n_decoded % 8 == 0, "%zu bits decoded", n_decoded);
+        return out;
+    }
+}
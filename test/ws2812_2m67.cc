@@ -0,0 +1,48 @@
+/* The 3-bit WS2812 encoding at 2.67MHz, decoded back from the SPI bitstream */
+#include "periph/spi.hh"
+#include "waveform.hh"
+
+int main()
+{
+    using transcoder = spi::transcode_2m67;
+    constexpr auto spec = led::chips::ws2812::spec;
+    constexpr auto bit_ps = spi::bit_ps(spi::FREQ_2M67);
+
+    static_assert(spi::FREQ_8M == 0, "a zeroed spi_init must still mean 8MHz");
+
+    static transcoder encoder;
+    test::margins m;
+
+    /* every value of every color, next to values with a mix of bits */
+    for (size_t c = 0; c < 3; ++c) {
+        for (size_t v = 0; v <= UINT8_MAX; ++v) {
+            auto const value = color::rgb(c == 0 ? v : 0x5a, c == 1 ? v : 0xa5, c == 2 ? v : 0x3c);
+            uint8_t out[transcoder::bytes_per_led];
+            encoder.encode(&value, 1, out);
+
+            auto const bytes = test::decode(spec, out, sizeof(out), bit_ps, &m);
+            check(bytes.size() == 3, "color %zu value 0x%02zx: %zu bytes", c, v, bytes.size());
+            check(bytes[0] == value.green && bytes[1] == value.red && bytes[2] == value.blue,
+                "color %zu value 0x%02zx: decoded %02x %02x %02x", c, v, bytes[0], bytes[1], bytes[2]);
+        }
+    }
+
+    /* LEDs back to back, where each LED's last low time meets the next LED */
+    color::rgb values[64];
+    for (size_t i = 0; i < 64; ++i) {
+        values[i] = color::rgb(i * 4, ~i, i * 13);
+    }
+    static uint8_t frame[64 * transcoder::bytes_per_led];
+    encoder.encode(values, 64, frame);
+
+    auto const bytes = test::decode(spec, frame, sizeof(frame), bit_ps, &m);
+    check(bytes.size() == 3 * 64, "%zu bytes", bytes.size());
+    for (size_t i = 0; i < 64; ++i) {
+        check(bytes[3 * i] == values[i].green && bytes[3 * i + 1] == values[i].red && bytes[3 * i + 2] == values[i].blue, "LED %zu", i);
+    }
+
+    check((uint64_t)transcoder::bytes_per_reset * 8 * bit_ps >= (uint64_t)spec.reset_ns * 1000, "bus reset of %zu bytes", transcoder::bytes_per_reset);
+
+    printf("ws2812_2m67: ok, margins: high %lldns, period %lldns, low %lldns\n", (long long)m.high, (long long)m.period, (long long)m.low);
+    return 0;
+}
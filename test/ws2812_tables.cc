@@ -0,0 +1,92 @@
+/* WS2812 lookup-table encoders, against the bit-by-bit encoders they replaced */
+#include "periph/spi.hh"
+#include "test.hh"
+
+/* transcode_8mhz before the tables */
+static void bitwise_8mhz(color::rgb const &value, uint8_t *out)
+{
+    uint8_t const zero = 0b11100000, one = 0b11111000;
+    uint8_t const colors[3] = { value.green, value.red, value.blue };
+
+    for (size_t c = 0; c < 3; ++c) {
+        for (size_t bit = 0; bit < 8; ++bit) {
+            *out++ = (colors[c] & (0x80 >> bit)) ? one : zero;
+        }
+    }
+}
+
+/* transcode_8mhz_alt before the tables: 10 bits per WS2812 bit, 2 bits in 5 bytes */
+static void bitwise_8mhz_alt(color::rgb const &value, uint8_t *out)
+{
+    uint8_t const colors[3] = { value.green, value.red, value.blue };
+
+    for (size_t c = 0; c < 3; ++c) {
+        for (size_t half = 0; half < 2; ++half) {
+            auto const v = colors[c] << (4 * half);
+            *out++ = (v & 0x80) ? 0b11111100 : 0b11100000;
+            *out++ = (v & 0x40) ? 0b00111111 : 0b00111000;
+            *out++ = (v & 0x20) ? 0b00001111 : 0b00001110;
+            *out++ = (v & 0x20) ? 0b11000011 : 0b00000011;
+            *out++ = (v & 0x10) ? 0b11110000 : 0b10000000;
+        }
+    }
+}
+
+template<typename Transcoder, typename Reference>
+static void check_same(char const *name, Reference reference)
+{
+    constexpr auto led_size = Transcoder::bytes_per_led;
+    static Transcoder transcoder;
+    uint8_t got[led_size], expect[led_size];
+
+    /* every value of every color, next to values with a mix of bits */
+    for (size_t c = 0; c < 3; ++c) {
+        for (size_t v = 0; v <= UINT8_MAX; ++v) {
+            auto const value = color::rgb(c == 0 ? v : 0x5a, c == 1 ? v : 0xa5, c == 2 ? v : 0x3c);
+            transcoder.encode(&value, 1, got);
+            reference(value, expect);
+            check(memcmp(got, expect, led_size) == 0, "%s: color %zu value 0x%02zx", name, c, v);
+        }
+    }
+
+    /* and through the output buffer, LED after LED */
+    static uint8_t frame[2 * Transcoder::bytes_per_reset + 256 * led_size];
+    buffer buf(frame, sizeof(frame));
+    Transcoder buffered(buf);
+
+    check(buffered.write_bus_reset() == NRF_SUCCESS, "%s: bus reset", name);
+    for (size_t i = 0; i < 256; ++i) {
+        auto value = color::rgb(i, i * 7, ~i);
+        check(buffered.write(value) == NRF_SUCCESS, "%s: write %zu", name, i);
+    }
+    check(buffered.write_bus_reset() == NRF_SUCCESS, "%s: bus reset", name);
+    check(buffered.len() == sizeof(frame), "%s: %zu bytes", name, buffered.len());
+
+    for (size_t i = 0; i < Transcoder::bytes_per_reset; ++i) {
+        check(frame[i] == 0 && frame[sizeof(frame) - 1 - i] == 0, "%s: bus reset byte %zu", name, i);
+    }
+    for (size_t i = 0; i < 256; ++i) {
+        reference(color::rgb(i, i * 7, ~i), expect);
+        check(memcmp(&frame[Transcoder::bytes_per_reset + i * led_size], expect, led_size) == 0, "%s: LED %zu", name, i);
+    }
+
+    static uint8_t out[1024 * led_size];
+    auto const table_ns = test::ns_per(1 << 20, [](size_t i) {
+        auto const value = color::rgb(i, i >> 8, i * 7);
+        transcoder.encode(&value, 1, &out[(i % 1024) * led_size]);
+    });
+    auto const bitwise_ns = test::ns_per(1 << 20, [&](size_t i) {
+        auto const value = color::rgb(i, i >> 8, i * 7);
+        reference(value, &out[(i % 1024) * led_size]);
+    });
+    test::sink += out[0];
+
+    printf("%s: ok, tables %.2f ns/LED, bitwise %.2f ns/LED\n", name, table_ns, bitwise_ns);
+}
+
+int main()
+{
+    check_same<spi::transcode_8mhz>("transcode_8mhz", bitwise_8mhz);
+    check_same<spi::transcode_8mhz_alt>("transcode_8mhz_alt", bitwise_8mhz_alt);
+    return 0;
+}